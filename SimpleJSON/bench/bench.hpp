@@ -0,0 +1,190 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdarg>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <initializer_list>
+#include <new>
+#include <string>
+#include <vector>
+
+/**
+ *  What the benchmarks share: the command line, timing with warm-up and
+ *  repeats, heap use counted by replacing operator new, and results
+ *  printed as a table or as csv.
+ *
+ *  Every benchmark takes
+ *
+ *      --warmup N  untimed runs before the timed ones (1)
+ *      --repeat N  timed runs, the fastest of which is reported (5)
+ *      --csv       one line per result, with a header line, and no notes
+ *
+ *  plus arguments of its own. Each benchmark is one source file and
+ *  includes this once, as it defines the replacement operator new.
+ */
+
+namespace bench {
+
+    /// operator new calls, and the bytes they hold that aren't freed yet.
+    inline size_t Allocations = 0;
+    inline size_t LiveBytes = 0;
+
+    namespace detail {
+        // Each allocation has its size just in front of it, at the end of
+        // a header as big as its alignment, so the header keeps it aligned.
+        inline void *allocate( size_t n, size_t alignment ) {
+            const size_t header = std::max( alignment, alignof( std::max_align_t ) );
+            const size_t total = ( header + n + alignment - 1 ) / alignment * alignment;
+            char *base = static_cast<char*>( alignment > alignof( std::max_align_t )
+                                             ? std::aligned_alloc( alignment, total )
+                                             : std::malloc( total ) );
+            if( !base )
+                throw std::bad_alloc();
+            char *p = base + header;
+            std::memcpy( p - sizeof( size_t ), &n, sizeof( size_t ) );
+            ++Allocations;
+            LiveBytes += n;
+            return p;
+        }
+
+        inline void deallocate( void *ptr, size_t alignment ) noexcept {
+            if( !ptr )
+                return;
+            char *p = static_cast<char*>( ptr );
+            size_t n;
+            std::memcpy( &n, p - sizeof( size_t ), sizeof( size_t ) );
+            LiveBytes -= n;
+            std::free( p - std::max( alignment, alignof( std::max_align_t ) ) );
+        }
+    }
+
+    struct Options {
+        int                      Warmup = 1;
+        int                      Repeat = 5;
+        bool                     Csv = false;
+        std::vector<std::string> Args;  // everything else, in order
+    };
+
+    /// The shared options, over the defaults given; a benchmark reads
+    /// its own from Args.
+    inline Options Parse( int argc, char **argv, Options opt = {} ) {
+        for( int i = 1; i < argc; ++i ) {
+            const std::string arg = argv[i];
+            if( arg == "--warmup" && i + 1 < argc )
+                opt.Warmup = std::max( 0, std::atoi( argv[++i] ) );
+            else if( arg == "--repeat" && i + 1 < argc )
+                opt.Repeat = std::max( 1, std::atoi( argv[++i] ) );
+            else if( arg == "--csv" )
+                opt.Csv = true;
+            else
+                opt.Args.push_back( arg );
+        }
+        return opt;
+    }
+
+    /// The fastest timed run, and how many allocations it made.
+    struct Result {
+        double Seconds;
+        double Allocations;
+    };
+
+    /// Runs f() Warmup times, then Repeat times timed.
+    template <typename F>
+    Result Measure( const Options &opt, F &&f ) {
+        for( int w = 0; w < opt.Warmup; ++w )
+            f();
+
+        Result best{ 1e30, 0 };
+        for( int r = 0; r < opt.Repeat; ++r ) {
+            const size_t before = Allocations;
+            const auto start = std::chrono::steady_clock::now();
+            f();
+            const double seconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+            if( seconds < best.Seconds )
+                best = Result{ seconds, double( Allocations - before ) };
+        }
+        return best;
+    }
+
+    /// A column of numbers: its heading, and the digits after the point.
+    struct Column {
+        const char *Name;
+        int         Precision;
+    };
+
+    /**
+     *  Prints results, a row at a time, under labels and columns given
+     *  up front: lined up for reading, or as csv with the headings as
+     *  its first line.
+     */
+    class Report {
+        public:
+            Report( const Options &opt, std::initializer_list<const char*> labels, std::initializer_list<Column> columns )
+                : Csv( opt.Csv ), Columns( columns )
+            {
+                bool first = true;
+                for( const char *label : labels ) {
+                    if( Csv )
+                        std::printf( first ? "%s" : ",%s", label );
+                    else
+                        std::printf( "%-24s ", label );
+                    first = false;
+                }
+                for( const Column &c : Columns )
+                    std::printf( Csv ? ",%s" : " %14s", c.Name );
+                std::printf( "\n" );
+            }
+
+            void Row( std::initializer_list<std::string> labels, std::initializer_list<double> values ) const {
+                bool first = true;
+                for( const std::string &label : labels ) {
+                    if( Csv )
+                        std::printf( first ? "%s" : ",%s", label.c_str() );
+                    else
+                        std::printf( "%-24s ", label.c_str() );
+                    first = false;
+                }
+                size_t i = 0;
+                for( const double v : values ) {
+                    const int precision = i < Columns.size() ? Columns[i].Precision : 2;
+                    std::printf( Csv ? ",%.*f" : " %14.*f", precision, v );
+                    ++i;
+                }
+                std::printf( "\n" );
+            }
+
+            /// A line of context, such as the input's size; left out of csv.
+            void Note( const char *format, ... ) const {
+                if( Csv )
+                    return;
+                va_list args;
+                va_start( args, format );
+                std::vprintf( format, args );
+                va_end( args );
+                std::printf( "\n" );
+            }
+
+        private:
+            bool                Csv;
+            std::vector<Column> Columns;
+    };
+}
+
+void *operator new( size_t n ) { return bench::detail::allocate( n, alignof( std::max_align_t ) ); }
+void *operator new[]( size_t n ) { return bench::detail::allocate( n, alignof( std::max_align_t ) ); }
+void operator delete( void *p ) noexcept { bench::detail::deallocate( p, alignof( std::max_align_t ) ); }
+void operator delete[]( void *p ) noexcept { bench::detail::deallocate( p, alignof( std::max_align_t ) ); }
+void operator delete( void *p, size_t ) noexcept { bench::detail::deallocate( p, alignof( std::max_align_t ) ); }
+void operator delete[]( void *p, size_t ) noexcept { bench::detail::deallocate( p, alignof( std::max_align_t ) ); }
+
+// std::pmr::new_delete_resource() allocates through these.
+void *operator new( size_t n, std::align_val_t a ) { return bench::detail::allocate( n, size_t( a ) ); }
+void *operator new[]( size_t n, std::align_val_t a ) { return bench::detail::allocate( n, size_t( a ) ); }
+void operator delete( void *p, std::align_val_t a ) noexcept { bench::detail::deallocate( p, size_t( a ) ); }
+void operator delete[]( void *p, std::align_val_t a ) noexcept { bench::detail::deallocate( p, size_t( a ) ); }
+void operator delete( void *p, size_t, std::align_val_t a ) noexcept { bench::detail::deallocate( p, size_t( a ) ); }
+void operator delete[]( void *p, size_t, std::align_val_t a ) noexcept { bench::detail::deallocate( p, size_t( a ) ); }
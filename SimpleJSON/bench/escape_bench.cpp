@@ -0,0 +1,95 @@
+#include "json.hpp"
+#include "bench.hpp"
+#include <cstdio>
+#include <cstring>
+#include <random>
+
+using namespace std;
+using json::JSON;
+
+/**
+ *  String escaping benchmark.
+ *
+ *  Writes a large table of plain text strings, the way the decoder
+ *  builds one from a TOML document, and reports output throughput for
+ *  Writer::String(), for escaping each string into a copy of its own
+ *  first and writing that as it is (what the decoder used to do), and
+ *  for a memcpy of the finished output, the ceiling for both.
+ *
+ *  Usage: escape_bench [count] [--warmup N] [--repeat N] [--csv]
+ */
+
+namespace {
+    // A byte at a time, into a new string, as another_toml::to_escaped_string does.
+    string escaped_copy( const string &str ) {
+        string out;
+        for( const char c : str ) {
+            switch( c ) {
+                case '"':  out += "\\\""; break;
+                case '\\': out += "\\\\"; break;
+                case '\n': out += "\\n"; break;
+                case '\t': out += "\\t"; break;
+                default:   out += c;
+            }
+        }
+        return out;
+    }
+
+    void report( const bench::Report &table, const char *name, size_t bytes, const bench::Result &r ) {
+        table.Row( { name }, { bytes / r.Seconds / 1e6, r.Allocations } );
+    }
+}
+
+int main( int argc, char **argv )
+{
+    const bench::Options opt = bench::Parse( argc, argv );
+    const size_t count = opt.Args.size() > 0 ? strtoul( opt.Args[0].c_str(), nullptr, 10 ) : 200000;
+
+    // Mostly prose, with the odd quote, tab or newline to escape.
+    mt19937 rng( 42 );
+    const char text[] = "the quick brown fox jumps over the lazy dog ";
+    vector<string> keys, values;
+    for( size_t i = 0; i < count; ++i ) {
+        string value;
+        const size_t length = 16 + rng() % 240;
+        for( size_t j = 0; j < length; ++j )
+            value += rng() % 200 ? text[j % ( sizeof( text ) - 1 )] : "\"\\\n\t"[rng() % 4];
+        keys.push_back( "key" + to_string( i ) );
+        values.push_back( std::move( value ) );
+    }
+
+    string out;
+    out.reserve( count * 300 );
+    const auto written = [&]{
+        out.clear();
+        json::Writer w( out, json::Writer::Style::Compact );
+        w.BeginObject();
+        for( size_t i = 0; i < count; ++i ) {
+            w.Key( keys[i] );
+            w.String( values[i] );
+        }
+        w.EndObject();
+    };
+    written();
+    const size_t bytes = out.size();
+    const bench::Report table( opt, { "writing" }, { { "MB/s", 1 }, { "allocs", 0 } } );
+    table.Note( "%zu strings, %.1f MB of output, best of %d", count, bytes / 1e6, opt.Repeat );
+
+    report( table, "Writer::String", bytes, bench::Measure( opt, written ) );
+
+    report( table, "escaped copy, RawString", bytes, bench::Measure( opt, [&]{
+        out.clear();
+        json::Writer w( out, json::Writer::Style::Compact );
+        w.BeginObject();
+        for( size_t i = 0; i < count; ++i ) {
+            w.Key( keys[i] );
+            w.RawString( escaped_copy( values[i] ) );
+        }
+        w.EndObject();
+    } ) );
+
+    string copy( bytes, '\0' );
+    report( table, "memcpy of the output", bytes, bench::Measure( opt, [&]{
+        memcpy( &copy[0], out.data(), bytes );
+    } ) );
+}
@@ -0,0 +1,237 @@
+#include "json.hpp"
+#include "bench.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <dirent.h>
+#include <fstream>
+#include <random>
+#include <sstream>
+
+using namespace std;
+using json::JSON;
+
+/**
+ *  Parse and serialize benchmark.
+ *
+ *  For each input, reports parse throughput for JSON::Load,
+ *  Document::Load and Tape::Load, and serialize throughput for a
+ *  compact and a pretty json::Writer. Each result also gives ns per
+ *  node and heap allocations per document.
+ *
+ *  The inputs are the files in test/cases, taken together, a toml-test
+ *  document, and synthetic documents of numbers, strings and nested
+ *  objects. Files named on the command line are added to them.
+ *
+ *  Each measurement runs --warmup untimed rounds, then keeps the best
+ *  of --repeat timed ones. A round repeats the operation until at least
+ *  --bytes of input has been handled, so small inputs still time well.
+ *  --csv prints one line per measurement, for comparing versions.
+ *
+ *  Usage: json_bench [--warmup N] [--repeat N] [--bytes N] [--scale N]
+ *                    [--cases DIR] [--csv] [file...]
+ */
+
+namespace {
+    struct Options {
+        bench::Options Bench;
+        size_t         Bytes = 32 << 20;   // per round
+        size_t         Scale = 1;
+        string         Cases = "test/cases";
+    };
+
+    struct Input {
+        string         Name;
+        vector<string> Texts;   // loaded one after another, as one document each
+        size_t         Bytes = 0;
+        size_t         Nodes = 0;
+    };
+
+    struct Result {
+        double Seconds;         // per round of Input::Texts
+        double Allocations;     // per document
+    };
+
+    size_t count_nodes( const JSON &j ) {
+        size_t n = 1;
+        for( auto &p : j.ObjectRange() )
+            n += count_nodes( p.second );
+        for( auto &e : j.ArrayRange() )
+            n += count_nodes( e );
+        return n;
+    }
+
+    // Runs f over every text of input, rounds times.
+    template <typename F>
+    void run( const Input &input, size_t rounds, F &f ) {
+        for( size_t r = 0; r < rounds; ++r )
+            for( size_t i = 0; i < input.Texts.size(); ++i )
+                f( i );
+    }
+
+    template <typename F>
+    Result measure( const Options &opt, const Input &input, F f ) {
+        const size_t rounds = max<size_t>( 1, opt.Bytes / max<size_t>( input.Bytes, 1 ) );
+        const bench::Result best = bench::Measure( opt.Bench, [&]{ run( input, rounds, f ); } );
+        return Result{ best.Seconds / rounds, best.Allocations / ( rounds * input.Texts.size() ) };
+    }
+
+    void report( const bench::Report &table, const Input &input, const char *operation, size_t bytes, const Result &r ) {
+        table.Row( { input.Name, operation },
+                   { double( bytes ), double( input.Nodes ), bytes / r.Seconds / 1e6,
+                     r.Seconds * 1e9 / input.Nodes, r.Allocations } );
+    }
+
+    void run_input( const Options &opt, const bench::Report &table, Input &input ) {
+        vector<JSON> trees;
+        for( const string &text : input.Texts ) {
+            input.Bytes += text.size();
+            trees.push_back( JSON::Load( text ) );
+            input.Nodes += count_nodes( trees.back() );
+        }
+
+        vector<string> compact( trees.size() ), pretty( trees.size() );
+        size_t compactBytes = 0, prettyBytes = 0;
+        for( size_t i = 0; i < trees.size(); ++i ) {
+            json::Writer( compact[i], json::Writer::Style::Compact ).Value( trees[i] );
+            json::Writer( pretty[i] ).Value( trees[i] );
+            compactBytes += compact[i].size();
+            prettyBytes += pretty[i].size();
+        }
+
+        report( table, input, "JSON::Load", input.Bytes, measure( opt, input, [&]( size_t i ) {
+            trees[i] = JSON::Load( input.Texts[i] );
+        } ) );
+
+        json::Document doc;
+        report( table, input, "Document::Load", input.Bytes, measure( opt, input, [&]( size_t i ) {
+            doc.Load( input.Texts[i] );
+        } ) );
+
+        json::Tape tape;
+        report( table, input, "Tape::Load", input.Bytes, measure( opt, input, [&]( size_t i ) {
+            tape.Load( input.Texts[i] );
+        } ) );
+
+        // Output sizes are the throughput basis; the strings keep their capacity.
+        report( table, input, "Writer compact", compactBytes, measure( opt, input, [&]( size_t i ) {
+            compact[i].clear();
+            json::Writer( compact[i], json::Writer::Style::Compact ).Value( trees[i] );
+        } ) );
+
+        report( table, input, "Writer pretty", prettyBytes, measure( opt, input, [&]( size_t i ) {
+            pretty[i].clear();
+            json::Writer( pretty[i] ).Value( trees[i] );
+        } ) );
+    }
+
+    string read_file( const string &path ) {
+        ifstream in( path, ios::binary );
+        stringstream ss;
+        ss << in.rdbuf();
+        return ss.str();
+    }
+
+    // Tables of toml-test leaves, with arrays of them and of tables.
+    string toml_test( size_t tables, mt19937 &rng ) {
+        const char *types[] = { "string", "integer", "float", "bool", "datetime" };
+        string text = "{";
+        for( size_t t = 0; t < tables; ++t ) {
+            text += ( t ? ",\n  \"table" : "\n  \"table" ) + to_string( t ) + "\": {";
+            for( int k = 0; k < 6; ++k )
+                text += ( k ? ", \"key" : "\"key" ) + to_string( k ) + "\": {\"type\": \"" +
+                        types[rng() % 5] + "\", \"value\": \"" + to_string( rng() ) + "\"}";
+            text += ", \"list\": [{\"type\": \"string\", \"value\": \"tab\\tand \\\"quotes\\\"\"}]";
+            text += ", \"tables\": [{\"a\": {\"type\": \"integer\", \"value\": \"1\"}}, {}]}";
+        }
+        return text + "\n}\n";
+    }
+
+    string numbers( size_t count, mt19937 &rng ) {
+        uniform_real_distribution<double> real( -1e6, 1e6 );
+        string text = "[";
+        char buf[32];
+        for( size_t i = 0; i < count; ++i ) {
+            if( i % 2 )
+                snprintf( buf, sizeof( buf ), "%ld", long( rng() ) - 2147483647L );
+            else
+                snprintf( buf, sizeof( buf ), "%.17g", real( rng ) );
+            text += i ? "," : "";
+            text += buf;
+        }
+        return text + "]";
+    }
+
+    string strings( size_t count, mt19937 &rng ) {
+        const char prose[] = "the quick brown fox jumps over the lazy dog ";
+        string text = "[";
+        for( size_t i = 0; i < count; ++i ) {
+            text += i ? ",\"" : "\"";
+            for( size_t j = 0, n = 4 + rng() % 120; j < n; ++j )
+                text += rng() % 64 ? string( 1, prose[j % ( sizeof( prose ) - 1 )] ) : "\\n";
+            text += '"';
+        }
+        return text + "]";
+    }
+
+    // Objects of objects, a few levels deep.
+    string nested( size_t count, mt19937 &rng, int depth = 0 ) {
+        string text = "{";
+        for( size_t i = 0; i < count; ++i ) {
+            text += ( i ? ",\"n" : "\"n" ) + to_string( i ) + "\":";
+            if( depth < 3 )
+                text += nested( 4, rng, depth + 1 );
+            else
+                text += rng() % 2 ? "[true,false,null]" : to_string( rng() % 1000 );
+        }
+        return text + "}";
+    }
+}
+
+int main( int argc, char **argv )
+{
+    Options opt;
+    opt.Bench = bench::Parse( argc, argv );
+    vector<string> files;
+    const vector<string> &args = opt.Bench.Args;
+    for( size_t i = 0; i < args.size(); ++i ) {
+        const string &arg = args[i];
+        const bool value = i + 1 < args.size();
+        if( arg == "--bytes" && value )
+            opt.Bytes = strtoul( args[++i].c_str(), nullptr, 10 );
+        else if( arg == "--scale" && value )
+            opt.Scale = max<size_t>( 1, strtoul( args[++i].c_str(), nullptr, 10 ) );
+        else if( arg == "--cases" && value )
+            opt.Cases = args[++i];
+        else if( arg.compare( 0, 2, "--" ) == 0 ) {
+            fprintf( stderr, "unknown option %s\n", arg.c_str() );
+            return 1;
+        }
+        else
+            files.push_back( arg );
+    }
+
+    vector<Input> inputs;
+    Input cases{ "cases", {} };
+    if( DIR *d = opendir( opt.Cases.c_str() ) ) {
+        while( dirent *e = readdir( d ) )
+            if( e->d_name[0] != '.' )
+                cases.Texts.push_back( read_file( opt.Cases + "/" + e->d_name ) );
+        closedir( d );
+    }
+    if( !cases.Texts.empty() )
+        inputs.push_back( std::move( cases ) );
+
+    mt19937 rng( 42 );
+    inputs.push_back( Input{ "toml-test", { toml_test( 20000 * opt.Scale, rng ) } } );
+    inputs.push_back( Input{ "numbers", { numbers( 500000 * opt.Scale, rng ) } } );
+    inputs.push_back( Input{ "strings", { strings( 200000 * opt.Scale, rng ) } } );
+    inputs.push_back( Input{ "nested", { nested( 5000 * opt.Scale, rng ) } } );
+    for( const string &f : files )
+        inputs.push_back( Input{ f, { read_file( f ) } } );
+
+    const bench::Report table( opt.Bench, { "input", "operation" },
+                               { { "bytes", 0 }, { "nodes", 0 }, { "mb_per_s", 1 },
+                                 { "ns_per_node", 2 }, { "allocs_per_doc", 2 } } );
+    for( Input &input : inputs )
+        run_input( opt, table, input );
+}
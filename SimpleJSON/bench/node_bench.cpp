@@ -0,0 +1,220 @@
+#include "json.hpp"
+#include "bench.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <dirent.h>
+#include <fstream>
+#include <random>
+#include <sstream>
+
+using namespace std;
+using json::JSON;
+
+/**
+ *  Node memory benchmark.
+ *
+ *  Loads the files in a directory (test/cases by default) and a few
+ *  large generated documents, and reports heap bytes per node for the
+ *  node layout from before arrays were vectors and short strings were
+ *  kept inline, and for the current one. Both are measured by building
+ *  the same allocations JSON::Load makes for the tree with each layout;
+ *  objects are built the same way for both, less their lookup index.
+ *  The JSON::Load column is what loading actually kept, as a check on
+ *  the model, and Load ns/node how long loading took.
+ *
+ *  Usage: node_bench [directory] [scale] [--warmup N] [--repeat N] [--csv]
+ */
+
+namespace {
+    using bench::Allocations;
+    using bench::LiveBytes;
+
+    // A 16 byte node with the allocations of one layout or the other.
+    template <bool Old>
+    struct Node {
+        using Array  = conditional_t<Old, pmr::deque<Node>, pmr::vector<Node>>;
+        using Object = pmr::vector<pair<pmr::string, Node>>;
+        using Tagged = pair<pmr::string, pmr::string>;
+
+        void       *Data = nullptr;
+        JSON::Class Type = JSON::Class::Null;
+        bool        Heap = false;
+        uint32_t    Length = 0;
+
+        static Node Build( const JSON &j ) {
+            Node n;
+            n.Type = j.JSONType();
+            switch( n.Type ) {
+                case JSON::Class::Object: {
+                    auto *map = new Object;
+                    for( auto &p : j.ObjectRange() )
+                        map->emplace_back( pmr::string( p.first ), Build( p.second ) );
+                    n.Data = map;
+                    break;
+                }
+                case JSON::Class::Array: {
+                    auto *list = new Array;
+                    for( auto &e : j.ArrayRange() )
+                        list->push_back( Build( e ) );
+                    n.Data = list;
+                    break;
+                }
+                case JSON::Class::Tagged:
+                    n.Data = new Tagged( j.TagType(), j.TagValue() );
+                    break;
+                case JSON::Class::String:
+                    n.Heap = Old || j.ToStringView().size() > JSON::SmallCapacity;
+                    if( n.Heap )
+                        n.Data = new pmr::string( j.ToStringView() );
+                    break;
+                default:
+                    break;
+            }
+            return n;
+        }
+
+        void Free() {
+            switch( Type ) {
+                case JSON::Class::Object:
+                    for( auto &p : *static_cast<Object*>( Data ) )
+                        p.second.Free();
+                    delete static_cast<Object*>( Data );
+                    break;
+                case JSON::Class::Array:
+                    for( auto &e : *static_cast<Array*>( Data ) )
+                        e.Free();
+                    delete static_cast<Array*>( Data );
+                    break;
+                case JSON::Class::Tagged:
+                    delete static_cast<Tagged*>( Data );
+                    break;
+                case JSON::Class::String:
+                    if( Heap )
+                        delete static_cast<pmr::string*>( Data );
+                    break;
+                default:
+                    break;
+            }
+        }
+    };
+
+    size_t count_nodes( const JSON &j ) {
+        size_t n = 1;
+        for( auto &p : j.ObjectRange() )
+            n += count_nodes( p.second );
+        for( auto &e : j.ArrayRange() )
+            n += count_nodes( e );
+        return n;
+    }
+
+    struct Usage {
+        size_t Bytes, Allocations;
+    };
+
+    template <bool Old>
+    Usage layout_usage( const JSON &tree ) {
+        const size_t bytes = LiveBytes, count = Allocations;
+        Node<Old> root = Node<Old>::Build( tree );
+        const Usage used{ LiveBytes - bytes, Allocations - count };
+        root.Free();
+        return used;
+    }
+
+    void report( const bench::Options &opt, const bench::Report &table, const string &name, const vector<string> &texts ) {
+        size_t nodes = 0;
+        Usage loaded{ 0, 0 }, old{ 0, 0 }, now{ 0, 0 };
+        for( const string &text : texts ) {
+            const size_t bytes = LiveBytes, count = Allocations;
+            JSON tree = JSON::Load( text );
+            loaded.Bytes += LiveBytes - bytes;
+            loaded.Allocations += Allocations - count;
+            nodes += count_nodes( tree );
+            const Usage o = layout_usage<true>( tree ), n = layout_usage<false>( tree );
+            old.Bytes += o.Bytes;
+            old.Allocations += o.Allocations;
+            now.Bytes += n.Bytes;
+            now.Allocations += n.Allocations;
+        }
+
+        const bench::Result timed = bench::Measure( opt, [&]{
+            for( const string &text : texts )
+                JSON::Load( text );
+        } );
+
+        table.Row( { name }, { double( nodes ), double( old.Bytes ) / nodes, double( now.Bytes ) / nodes,
+                               double( loaded.Bytes ) / nodes, double( old.Allocations ),
+                               double( now.Allocations ), timed.Seconds * 1e9 / nodes } );
+    }
+
+    string read_file( const string &path ) {
+        ifstream in( path );
+        stringstream ss;
+        ss << in.rdbuf();
+        return ss.str();
+    }
+
+    // Tables of toml-test leaves, the shape the encoder reads.
+    string toml_test_document( size_t tables, mt19937 &rng ) {
+        const char *types[] = { "string", "integer", "float", "bool", "datetime" };
+        string text = "{";
+        for( size_t t = 0; t < tables; ++t ) {
+            text += ( t ? ",\"table" : "\"table" ) + to_string( t ) + "\":{";
+            for( int k = 0; k < 8; ++k )
+                text += ( k ? ",\"key" : "\"key" ) + to_string( k ) + "\":{\"type\":\"" +
+                        types[rng() % 5] + "\",\"value\":\"" + to_string( rng() ) + "\"}";
+            text += ",\"list\":[";
+            for( int e = 0; e < 4; ++e )
+                text += string( e ? "," : "" ) + "{\"type\":\"integer\",\"value\":\"" + to_string( rng() % 100 ) + "\"}";
+            text += "]}";
+        }
+        return text + "}";
+    }
+
+    string short_strings( size_t count, mt19937 &rng ) {
+        string text = "[";
+        for( size_t i = 0; i < count; ++i ) {
+            text += i ? ",\"" : "\"";
+            text.append( 1 + rng() % 20, char( 'a' + rng() % 26 ) );
+            text += '"';
+        }
+        return text + "]";
+    }
+
+    string small_arrays( size_t count, mt19937 &rng ) {
+        string text = "[";
+        for( size_t i = 0; i < count; ++i ) {
+            text += i ? ",[" : "[";
+            for( unsigned e = 0, n = rng() % 6; e < n; ++e )
+                text += ( e ? "," : "" ) + to_string( rng() % 1000 );
+            text += ']';
+        }
+        return text + "]";
+    }
+}
+
+int main( int argc, char **argv )
+{
+    const bench::Options opt = bench::Parse( argc, argv );
+    const string dir = opt.Args.size() > 0 ? opt.Args[0] : "test/cases";
+    const size_t scale = opt.Args.size() > 1 ? strtoul( opt.Args[1].c_str(), nullptr, 10 ) : 100000;
+
+    const bench::Report table( opt, { "input" },
+                               { { "nodes", 0 }, { "old B/node", 1 }, { "new B/node", 1 }, { "Load B/node", 1 },
+                                 { "old allocs", 0 }, { "new allocs", 0 }, { "Load ns/node", 1 } } );
+
+    // The files are small, so they are reported together.
+    vector<string> files;
+    if( DIR *d = opendir( dir.c_str() ) ) {
+        while( dirent *e = readdir( d ) )
+            if( e->d_name[0] != '.' )
+                files.push_back( read_file( dir + "/" + e->d_name ) );
+        closedir( d );
+    }
+    report( opt, table, dir, files );
+
+    mt19937 rng( 42 );
+    report( opt, table, "toml-test leaves", { toml_test_document( scale / 10, rng ) } );
+    report( opt, table, "short strings", { short_strings( scale * 10, rng ) } );
+    report( opt, table, "small arrays", { small_arrays( scale * 2, rng ) } );
+}
@@ -0,0 +1,127 @@
+#include "json.hpp"
+#include "bench.hpp"
+#include <cmath>
+#include <cstdio>
+#include <random>
+
+using namespace std;
+using json::JSON;
+
+/**
+ *  Number parsing benchmark.
+ *
+ *  Loads a large array of floats and integers, and reports throughput
+ *  for JSON::Load, for Document::LoadInPlace with and without
+ *  KeepNumberText, and for the stod/pow conversion Load used to do,
+ *  along with how many floats each way reads back exactly.
+ *
+ *  Usage: number_bench [count] [--warmup N] [--repeat N] [--csv]
+ */
+
+namespace {
+    // The conversion parse_number did before it used from_chars.
+    double legacy_number( const string &str, size_t &offset ) {
+        string val, exp_str;
+        char c;
+        bool isDouble = false;
+        long exp = 0;
+        while( true ) {
+            c = str[offset++];
+            if( (c == '-') || (c >= '0' && c <= '9') )
+                val += c;
+            else if( c == '.' ) {
+                val += c;
+                isDouble = true;
+            }
+            else
+                break;
+        }
+        if( c == 'E' || c == 'e' ) {
+            c = str[ offset++ ];
+            if( c == '-' ){ ++offset; exp_str += '-';}
+            while( true ) {
+                c = str[ offset++ ];
+                if( c >= '0' && c <= '9' )
+                    exp_str += c;
+                else
+                    break;
+            }
+            exp = std::stol( exp_str );
+        }
+        --offset;
+        if( isDouble )
+            return std::stod( val ) * std::pow( 10, exp );
+        return std::stol( val ) * std::pow( 10, exp );
+    }
+
+    void report( const bench::Report &table, const char *name, size_t bytes, size_t numbers, const bench::Result &r ) {
+        table.Row( { name }, { bytes / r.Seconds / 1e6, r.Seconds * 1e9 / numbers, r.Allocations } );
+    }
+}
+
+int main( int argc, char **argv )
+{
+    const bench::Options opt = bench::Parse( argc, argv );
+    const size_t count = opt.Args.size() > 0 ? strtoul( opt.Args[0].c_str(), nullptr, 10 ) : 1000000;
+
+    // Half doubles written with all 17 digits, half integers.
+    mt19937_64 rng( 42 );
+    uniform_real_distribution<double> mantissa( -1.0, 1.0 );
+    uniform_int_distribution<int> exponent( -30, 30 );
+    uniform_int_distribution<long> integer( -1000000000L, 1000000000L );
+
+    vector<double> floats;
+    string text = "[";
+    char buf[32];
+    for( size_t i = 0; i < count; ++i ) {
+        if( i )
+            text += ", ";
+        if( i % 2 ) {
+            text += to_string( integer( rng ) );
+            continue;
+        }
+        const double d = mantissa( rng ) * pow( 10.0, exponent( rng ) );
+        snprintf( buf, sizeof( buf ), "%.17g", d );
+        floats.push_back( d );
+        text += buf;
+    }
+    text += "]\n";
+
+    const bench::Report table( opt, { "conversion" }, { { "MB/s", 1 }, { "ns/number", 1 }, { "allocs", 0 } } );
+    table.Note( "%zu numbers, %.1f MB, best of %d", count, text.size() / 1e6, opt.Repeat );
+
+    JSON loaded;
+    report( table, "JSON::Load", text.size(), count, bench::Measure( opt, [&]{
+        loaded = JSON::Load( text );
+    } ) );
+
+    json::Document doc;
+    report( table, "Document::LoadInPlace", text.size(), count, bench::Measure( opt, [&]{
+        doc.LoadInPlace( text );
+    } ) );
+
+    json::LoadOptions keep;
+    keep.KeepNumberText = true;
+    report( table, "  with KeepNumberText", text.size(), count, bench::Measure( opt, [&]{
+        doc.LoadInPlace( text, keep );
+    } ) );
+
+    vector<double> legacy( count );
+    report( table, "stod/pow conversion only", text.size(), count, bench::Measure( opt, [&]{
+        size_t offset = 1;
+        for( size_t i = 0; i < count; ++i ) {
+            legacy[i] = legacy_number( text, offset );
+            offset += 2;
+        }
+    } ) );
+
+    // %.17g writes some large floats without a '.' or exponent; those load as integers.
+    size_t exact = 0, legacyExact = 0;
+    for( size_t i = 0; i < floats.size(); ++i ) {
+        const JSON &n = loaded[unsigned( i * 2 )];
+        exact += ( n.JSONType() == JSON::Class::Integral ? double( n.ToInt() ) : n.ToFloat() ) == floats[i];
+        legacyExact += legacy[i * 2] == floats[i];
+    }
+    table.Note( "floats read back exactly: %zu/%zu, stod/pow: %zu/%zu",
+                exact, floats.size(), legacyExact, floats.size() );
+}
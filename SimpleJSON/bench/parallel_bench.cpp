@@ -0,0 +1,80 @@
+#include "json.hpp"
+#include "bench.hpp"
+#include <cstdio>
+#include <random>
+#include <thread>
+
+using namespace std;
+using json::JSON;
+
+/**
+ *  Parallel load benchmark.
+ *
+ *  Generates a large document of toml-test tables, and reports
+ *  throughput for JSON::Load and for JSON::LoadParallel on 1, 2, 4...
+ *  threads, up to the number of cores. Every parallel load is checked
+ *  against Load's tree.
+ *
+ *  Usage: parallel_bench [megabytes] [--warmup N] [--repeat N] [--csv]
+ *
+ *  The loads are big, so it defaults to no warm-up and three repeats.
+ */
+
+namespace {
+    void report( const bench::Report &table, const string &name, size_t bytes, const bench::Result &r ) {
+        table.Row( { name }, { bytes / r.Seconds / 1e6, r.Allocations } );
+    }
+
+    // Tables of toml-test leaves, with an array of them in each.
+    string generate( size_t bytes ) {
+        const char *types[] = { "string", "integer", "float", "bool", "datetime" };
+        mt19937 rng( 42 );
+        string text = "{";
+        for( size_t t = 0; text.size() < bytes; ++t ) {
+            text += ( t ? ",\n\"table" : "\n\"table" ) + to_string( t ) + "\": {";
+            for( int k = 0; k < 8; ++k )
+                text += ( k ? ", \"key" : "\"key" ) + to_string( k ) + "\": {\"type\": \"" +
+                        types[rng() % 5] + "\", \"value\": \"" + to_string( rng() ) + "\"}";
+            text += ", \"list\": [";
+            for( int e = 0; e < 4; ++e )
+                text += string( e ? ", " : "" ) + "{\"type\": \"string\", \"value\": \"a \\\"quoted\\\" " +
+                        to_string( rng() % 100 ) + "\"}";
+            text += "]}";
+        }
+        return text + "\n}\n";
+    }
+}
+
+int main( int argc, char **argv )
+{
+    bench::Options defaults;
+    defaults.Warmup = 0;
+    defaults.Repeat = 3;
+    const bench::Options opt = bench::Parse( argc, argv, defaults );
+    const size_t megabytes = opt.Args.size() > 0 ? strtoul( opt.Args[0].c_str(), nullptr, 10 ) : 64;
+    const unsigned cores = max( 1u, thread::hardware_concurrency() );
+
+    const string text = generate( megabytes << 20 );
+    const bench::Report table( opt, { "load" }, { { "MB/s", 1 }, { "allocs", 0 } } );
+    table.Note( "%.1f MB, %u cores, best of %d", text.size() / 1e6, cores, opt.Repeat );
+
+    JSON expected;
+    report( table, "JSON::Load", text.size(), bench::Measure( opt, [&]{
+        expected = JSON::Load( text );
+    } ) );
+    const string dumped = expected.dump();
+
+    for( unsigned threads = 1; ; threads = min( threads * 2, cores ) ) {
+        JSON loaded;
+        const bench::Result r = bench::Measure( opt, [&]{
+            loaded = JSON::LoadParallel( text, threads );
+        } );
+        report( table, "LoadParallel, " + to_string( threads ) + " thread" + ( threads > 1 ? "s" : "" ), text.size(), r );
+        if( loaded.dump() != dumped ) {
+            fprintf( stderr, "LoadParallel on %u threads differs from Load\n", threads );
+            return 1;
+        }
+        if( threads == cores )
+            break;
+    }
+}
@@ -2,17 +2,27 @@
 
 mkdir -p examples/bin
 mkdir -p test/bin
+mkdir -p bench/bin
 
 # Build Examples.
-clang++ -std=c++11 -I. ./examples/json_example.cpp -o ./examples/bin/json_example
-clang++ -std=c++11 -I. ./examples/array_example.cpp -o ./examples/bin/array_example
-clang++ -std=c++11 -I. ./examples/prim_example.cpp -o ./examples/bin/prim_example
-clang++ -std=c++11 -I. ./examples/init_example.cpp -o ./examples/bin/init_example
-clang++ -std=c++11 -I. ./examples/load_example.cpp -o ./examples/bin/load_example
-clang++ -std=c++11 -I. ./examples/iter_example.cpp -o ./examples/bin/iter_example
+clang++ -std=c++17 -I. ./examples/json_example.cpp -o ./examples/bin/json_example
+clang++ -std=c++17 -I. ./examples/array_example.cpp -o ./examples/bin/array_example
+clang++ -std=c++17 -I. ./examples/prim_example.cpp -o ./examples/bin/prim_example
+clang++ -std=c++17 -I. ./examples/init_example.cpp -o ./examples/bin/init_example
+clang++ -std=c++17 -I. ./examples/load_example.cpp -o ./examples/bin/load_example
+clang++ -std=c++17 -I. ./examples/iter_example.cpp -o ./examples/bin/iter_example
+
+# Build Benchmarks
+clang++ -std=c++17 -O2 -I. ./bench/number_bench.cpp -o ./bench/bin/number_bench
+clang++ -std=c++17 -O2 -I. ./bench/escape_bench.cpp -o ./bench/bin/escape_bench
+clang++ -std=c++17 -O2 -I. ./bench/node_bench.cpp -o ./bench/bin/node_bench
+clang++ -std=c++17 -O2 -pthread -I. ./bench/parallel_bench.cpp -o ./bench/bin/parallel_bench
+clang++ -std=c++17 -O2 -I. ./bench/json_bench.cpp -o ./bench/bin/json_bench
 
 # Build Test Tool
-clang++ -std=c++11 -I. ./test/tester.cpp -o ./test/bin/tester
+clang++ -std=c++17 -pthread -I. ./test/tester.cpp -o ./test/bin/tester
+clang++ -std=c++17 -I. ./test/chunk_test.cpp -o ./test/bin/chunk_test
+clang++ -std=c++17 -I. ./test/tagged_test.cpp -o ./test/bin/tagged_test
 
 echo "Done. See './examples' for examples, and './examples/bin' for the executables."
 echo "To run tests, run cd test; python ./run.py"
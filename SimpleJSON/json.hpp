@@ -1,22 +1,66 @@
 
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
+#include <cstdlib>
+#include <cstring>
 #include <cmath>
 #include <cctype>
+#include <algorithm>
+#include <atomic>
+#include <charconv>
 #include <string>
-#include <deque>
-#include <map>
+#include <string_view>
+#include <vector>
+#include <functional>
+#include <memory>
+#include <memory_resource>
+#include <optional>
+#include <stdexcept>
 #include <type_traits>
 #include <initializer_list>
 #include <ostream>
 #include <iostream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <system_error>
+
+// Whole files and standard input are read with the POSIX calls where
+// there are any, see PaddedString::ReadFile().
+#if defined( __unix__ ) || defined( __APPLE__ )
+#  define SIMPLEJSON_POSIX_IO 1
+#  include <cerrno>
+#  include <fcntl.h>
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#  include <unistd.h>
+#else
+#  include <fstream>
+#endif
+
+// Vector kernels for the parser's scanning loops. Define SIMPLEJSON_NO_SIMD
+// to force the portable scalar versions.
+#if !defined( SIMPLEJSON_NO_SIMD )
+#  if defined( __AVX2__ )
+#    define SIMPLEJSON_AVX2 1
+#    define SIMPLEJSON_SSE2 1
+#    include <immintrin.h>
+#  elif defined( __SSE2__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && _M_IX86_FP >= 2 )
+#    define SIMPLEJSON_SSE2 1
+#    include <emmintrin.h>
+#  endif
+#  if defined( _MSC_VER ) && defined( SIMPLEJSON_SSE2 )
+#    include <intrin.h>
+#  endif
+#endif
 
 namespace json {
 
-using std::map;
-using std::deque;
 using std::string;
+using std::string_view;
+using std::vector;
 using std::enable_if;
 using std::initializer_list;
 using std::is_same;
@@ -24,38 +68,442 @@ using std::is_convertible;
 using std::is_integral;
 using std::is_floating_point;
 
+class Writer;
+class Document;
+class PaddedString;
+struct LoadResult;
+
+/// Types a JSON string can be made from.
+template <typename T>
+struct is_string {
+    static constexpr bool value = is_convertible<T,string>::value || is_convertible<T,string_view>::value;
+};
+
+/// Why a load stopped.
+enum class ErrorCode : uint8_t {
+    None,
+    UnexpectedEnd,          // the input stops inside a value
+    UnexpectedCharacter,    // no value starts with this character
+    ExpectedKey,
+    ExpectedColon,
+    ExpectedCommaOrBrace,   // ',' or '}'
+    ExpectedCommaOrBracket, // ',' or ']'
+    BadLiteral,             // not true, false or null
+    BadNumber,
+    UnterminatedString,
+    TrailingCharacters      // something other than whitespace after the document
+};
+
+/**
+ *  Where and why a load failed. Turning the offset into a line and
+ *  column means counting newlines, so that is left until Locate() is
+ *  called on the failure path.
+ */
+struct ParseError {
+    ErrorCode Code = ErrorCode::None;
+    size_t    Offset = 0;   // in bytes, from the start of the input
+
+    /// True if there was an error.
+    explicit operator bool() const { return Code != ErrorCode::None; }
+
+    const char *Message() const {
+        switch( Code ) {
+            case ErrorCode::None:                   return "No error";
+            case ErrorCode::UnexpectedEnd:          return "Unexpected end of input";
+            case ErrorCode::UnexpectedCharacter:    return "Unexpected character";
+            case ErrorCode::ExpectedKey:            return "Expected a key";
+            case ErrorCode::ExpectedColon:          return "Expected ':' after a key";
+            case ErrorCode::ExpectedCommaOrBrace:   return "Expected ',' or '}'";
+            case ErrorCode::ExpectedCommaOrBracket: return "Expected ',' or ']'";
+            case ErrorCode::BadLiteral:             return "Expected 'true', 'false' or 'null'";
+            case ErrorCode::BadNumber:              return "Malformed number";
+            case ErrorCode::UnterminatedString:     return "Unterminated string";
+            case ErrorCode::TrailingCharacters:     return "Unexpected characters after the document";
+        }
+        return "Unknown error";
+    }
+
+    struct Position {
+        size_t Line;    // from 1
+        size_t Column;  // from 1, in bytes
+    };
+
+    /// Line and column of the error; input must be the text that was loaded.
+    Position Locate( string_view input ) const {
+        const string_view before = input.substr( 0, Offset );
+        const size_t newline = before.rfind( '\n' );
+        const size_t line = 1 + size_t( std::count( before.begin(), before.end(), '\n' ) );
+        return Position{ line, newline == string_view::npos ? Offset + 1 : Offset - newline };
+    }
+};
+
 namespace {
-    const string& json_escape( const string &str ) {
-        return str;
+    /**
+     *  Scanning kernels.
+     *
+     *  Whitespace and string bodies make up most of a typical document,
+     *  so these classify 16 (SSE2) or 32 (AVX2) bytes at a time and hand
+     *  the parser the position of the next byte it has to look at. The
+     *  writer does the same to find the bytes a string has to escape. Only
+     *  whole blocks inside [p, end) are loaded; the tail is done a byte
+     *  at a time.
+     */
+
+    // JSON whitespace only; isspace() also accepts \v and \f and depends on the locale.
+    inline bool is_ws( char c ) {
+        return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+    }
+
+#if defined( SIMPLEJSON_SSE2 )
+    inline unsigned trailing_zeros( uint32_t mask ) {
+#  if defined( _MSC_VER ) && !defined( __clang__ )
+        unsigned long i;
+        _BitScanForward( &i, mask );
+        return i;
+#  else
+        return __builtin_ctz( mask );
+#  endif
+    }
+#endif
+
+    /**
+     *  First byte in [p, end) that isn't whitespace, or end.
+     *
+     *  Padded input has zeros from end on (see json::PaddedString). A zero
+     *  isn't whitespace, so the scan stops by itself, and whole blocks can
+     *  be loaded without checking how much input is left.
+     */
+    template <bool Padded = false>
+    inline const char *skip_ws( const char *p, const char *end ) {
+        // Most gaps are a single space or nothing at all.
+        if( ( !Padded && p == end ) || !is_ws( *p ) )
+            return p;
+
+#if defined( SIMPLEJSON_AVX2 )
+        const __m256i sp32 = _mm256_set1_epi8( ' ' ),  nl32 = _mm256_set1_epi8( '\n' );
+        const __m256i cr32 = _mm256_set1_epi8( '\r' ), tb32 = _mm256_set1_epi8( '\t' );
+        for( ; Padded || end - p >= 32; p += 32 ) {
+            const __m256i v = _mm256_loadu_si256( reinterpret_cast<const __m256i*>( p ) );
+            const __m256i ws = _mm256_or_si256(
+                _mm256_or_si256( _mm256_cmpeq_epi8( v, sp32 ), _mm256_cmpeq_epi8( v, nl32 ) ),
+                _mm256_or_si256( _mm256_cmpeq_epi8( v, cr32 ), _mm256_cmpeq_epi8( v, tb32 ) ) );
+            const uint32_t other = ~uint32_t( _mm256_movemask_epi8( ws ) );
+            if( other )
+                return p + trailing_zeros( other );
+        }
+#endif
+#if defined( SIMPLEJSON_SSE2 )
+        const __m128i sp = _mm_set1_epi8( ' ' ),  nl = _mm_set1_epi8( '\n' );
+        const __m128i cr = _mm_set1_epi8( '\r' ), tb = _mm_set1_epi8( '\t' );
+        for( ; Padded || end - p >= 16; p += 16 ) {
+            const __m128i v = _mm_loadu_si128( reinterpret_cast<const __m128i*>( p ) );
+            const __m128i ws = _mm_or_si128(
+                _mm_or_si128( _mm_cmpeq_epi8( v, sp ), _mm_cmpeq_epi8( v, nl ) ),
+                _mm_or_si128( _mm_cmpeq_epi8( v, cr ), _mm_cmpeq_epi8( v, tb ) ) );
+            const uint32_t other = ~uint32_t( _mm_movemask_epi8( ws ) ) & 0xFFFF;
+            if( other )
+                return p + trailing_zeros( other );
+        }
+#endif
+        while( ( Padded || p != end ) && is_ws( *p ) )
+            ++p;
+        return p;
+    }
+
+    /// First '"' or '\\' in [p, end), or end. Padded input stops at any
+    /// zero byte as well, which is at end at the latest.
+    template <bool Padded = false>
+    inline const char *find_quote_or_escape( const char *p, const char *end ) {
+#if defined( SIMPLEJSON_AVX2 )
+        const __m256i q32 = _mm256_set1_epi8( '"' ), bs32 = _mm256_set1_epi8( '\\' );
+        for( ; Padded || end - p >= 32; p += 32 ) {
+            const __m256i v = _mm256_loadu_si256( reinterpret_cast<const __m256i*>( p ) );
+            __m256i m = _mm256_or_si256( _mm256_cmpeq_epi8( v, q32 ), _mm256_cmpeq_epi8( v, bs32 ) );
+            if( Padded )
+                m = _mm256_or_si256( m, _mm256_cmpeq_epi8( v, _mm256_setzero_si256() ) );
+            const uint32_t hits = uint32_t( _mm256_movemask_epi8( m ) );
+            if( hits )
+                return p + trailing_zeros( hits );
+        }
+#endif
+#if defined( SIMPLEJSON_SSE2 )
+        const __m128i q = _mm_set1_epi8( '"' ), bs = _mm_set1_epi8( '\\' );
+        for( ; Padded || end - p >= 16; p += 16 ) {
+            const __m128i v = _mm_loadu_si128( reinterpret_cast<const __m128i*>( p ) );
+            __m128i m = _mm_or_si128( _mm_cmpeq_epi8( v, q ), _mm_cmpeq_epi8( v, bs ) );
+            if( Padded )
+                m = _mm_or_si128( m, _mm_cmpeq_epi8( v, _mm_setzero_si128() ) );
+            const uint32_t hits = uint32_t( _mm_movemask_epi8( m ) );
+            if( hits )
+                return p + trailing_zeros( hits );
+        }
+#endif
+        while( ( Padded ? *p != '\0' : p != end ) && *p != '"' && *p != '\\' )
+            ++p;
+        return p;
+    }
+
+    /**
+     *  First byte in [p, end) that has to be escaped in a JSON string:
+     *  '"', '\\' or a control character. end if there is none.
+     *
+     *  Bytes from begin on can be read as well. When there are 16 of
+     *  them before end, the last partial block is loaded so that it
+     *  overlaps bytes already looked at, rather than going a byte at a time.
+     */
+    inline const char *find_escapable( const char *begin, const char *p, const char *end ) {
+#if defined( SIMPLEJSON_AVX2 )
+        const __m256i q32 = _mm256_set1_epi8( '"' ), bs32 = _mm256_set1_epi8( '\\' );
+        const __m256i ctl32 = _mm256_set1_epi8( 0x1F );
+        for( ; end - p >= 32; p += 32 ) {
+            const __m256i v = _mm256_loadu_si256( reinterpret_cast<const __m256i*>( p ) );
+            // max( v, 0x1F ) == 0x1F exactly for the unsigned bytes below 0x20.
+            const __m256i m = _mm256_or_si256(
+                _mm256_or_si256( _mm256_cmpeq_epi8( v, q32 ), _mm256_cmpeq_epi8( v, bs32 ) ),
+                _mm256_cmpeq_epi8( _mm256_max_epu8( v, ctl32 ), ctl32 ) );
+            const uint32_t hits = uint32_t( _mm256_movemask_epi8( m ) );
+            if( hits )
+                return p + trailing_zeros( hits );
+        }
+#endif
+#if defined( SIMPLEJSON_SSE2 )
+        const __m128i q = _mm_set1_epi8( '"' ), bs = _mm_set1_epi8( '\\' ), ctl = _mm_set1_epi8( 0x1F );
+        const auto escapable = [&]( const char *at ) {
+            const __m128i v = _mm_loadu_si128( reinterpret_cast<const __m128i*>( at ) );
+            const __m128i m = _mm_or_si128(
+                _mm_or_si128( _mm_cmpeq_epi8( v, q ), _mm_cmpeq_epi8( v, bs ) ),
+                _mm_cmpeq_epi8( _mm_max_epu8( v, ctl ), ctl ) );
+            return uint32_t( _mm_movemask_epi8( m ) );
+        };
+        for( ; end - p >= 16; p += 16 ) {
+            const uint32_t hits = escapable( p );
+            if( hits )
+                return p + trailing_zeros( hits );
+        }
+        if( p != end && end - begin >= 16 ) {
+            const uint32_t hits = escapable( end - 16 ) >> ( 16 - ( end - p ) );
+            return hits ? p + trailing_zeros( hits ) : end;
+        }
+#endif
+        while( p != end && *p != '"' && *p != '\\' && static_cast<unsigned char>( *p ) >= 0x20 )
+            ++p;
+        return p;
+    }
+
+    /// Appends str to out escaped for a JSON string. Runs with nothing to
+    /// escape, which is nearly all of most strings, are copied whole.
+    inline void escape_into( string &out, string_view str ) {
+        static const char hex[] = "0123456789abcdef";
+        const char *p = str.data(), *end = p + str.size();
+        while( true ) {
+            const char *stop = find_escapable( str.data(), p, end );
+            out.append( p, stop - p );
+            if( stop == end )
+                return;
+            const unsigned char c = static_cast<unsigned char>( *stop );
+            switch( c ) {
+                case '"':  out.append( "\\\"", 2 ); break;
+                case '\\': out.append( "\\\\", 2 ); break;
+                case '\b': out.append( "\\b", 2 ); break;
+                case '\f': out.append( "\\f", 2 ); break;
+                case '\n': out.append( "\\n", 2 ); break;
+                case '\r': out.append( "\\r", 2 ); break;
+                case '\t': out.append( "\\t", 2 ); break;
+                default: {
+                    const char u[] = { '\\', 'u', '0', '0', hex[c >> 4], hex[c & 0xF] };
+                    out.append( u, sizeof( u ) );
+                }
+            }
+            p = stop + 1;
+        }
+    }
+
+    string json_escape( string_view str ) {
+        string out;
+        out.reserve( str.size() );
+        escape_into( out, str );
+        return out;
     }
 }
 
 class JSON
 {
+    public:
+        /// Node storage. Memory comes from the active json::Document, or the heap.
+        /// Elements are contiguous, so walking an array reads memory in order.
+        using ArrayType  = std::pmr::vector<JSON>;
+        using StringType = std::pmr::string;
+
+        /**
+         *  Object members, kept in insertion order in one flat array.
+         *
+         *  Lookups take a string_view and never allocate. Small objects are
+         *  searched linearly; once an object grows past IndexThreshold an
+         *  open addressing table of (hash, position) slots is kept next to
+         *  the members.
+         */
+        class ObjectType {
+            public:
+                using value_type     = std::pair<StringType, JSON>;
+                using allocator_type = std::pmr::polymorphic_allocator<value_type>;
+                using iterator       = typename std::pmr::vector<value_type>::iterator;
+                using const_iterator = typename std::pmr::vector<value_type>::const_iterator;
+
+                static constexpr size_t IndexThreshold = 8;
+
+                explicit ObjectType( const allocator_type &alloc )
+                    : Members( alloc ), Slots( alloc ) {}
+
+                ObjectType( const ObjectType &other, const allocator_type &alloc )
+                    : Members( other.Members, alloc ), Slots( other.Slots, alloc ) {}
+
+                allocator_type get_allocator() const { return Members.get_allocator(); }
+
+                iterator begin() { return Members.begin(); }
+                iterator end() { return Members.end(); }
+                const_iterator begin() const { return Members.begin(); }
+                const_iterator end() const { return Members.end(); }
+
+                size_t size() const { return Members.size(); }
+                bool empty() const { return Members.empty(); }
+
+                void reserve( size_t n ) { Members.reserve( n ); }
+
+                iterator find( string_view key ) {
+                    return Members.begin() + Position( key );
+                }
+
+                const_iterator find( string_view key ) const {
+                    return Members.begin() + Position( key );
+                }
+
+                /// Finds key, appending a Null member for it if it isn't there.
+                JSON &operator[]( string_view key ) {
+                    const size_t pos = Position( key );
+                    if( pos != Members.size() )
+                        return Members[pos].second;
+
+                    Members.emplace_back( std::piecewise_construct,
+                                          std::forward_as_tuple( key ),
+                                          std::forward_as_tuple() );
+                    if( !Slots.empty() )
+                        Insert( Hash( key ), pos );
+                    else if( Members.size() > IndexThreshold )
+                        Rehash( 32 );
+                    return Members.back().second;
+                }
+
+            private:
+                struct Slot {
+                    uint32_t Hash;
+                    uint32_t Pos;   // position + 1, 0 is an empty slot
+                };
+
+                static size_t Hash( string_view key ) {
+                    return std::hash<string_view>()( key );
+                }
+
+                // Index of key in Members, or Members.size() if missing.
+                size_t Position( string_view key ) const {
+                    if( Slots.empty() ) {
+                        for( size_t i = 0; i < Members.size(); ++i )
+                            if( Members[i].first == key )
+                                return i;
+                        return Members.size();
+                    }
+
+                    const size_t h = Hash( key );
+                    const size_t mask = Slots.size() - 1;
+                    for( size_t i = h & mask; Slots[i].Pos; i = ( i + 1 ) & mask ) {
+                        const Slot &s = Slots[i];
+                        if( s.Hash == uint32_t( h ) && Members[s.Pos - 1].first == key )
+                            return s.Pos - 1;
+                    }
+                    return Members.size();
+                }
+
+                void Insert( size_t h, size_t pos ) {
+                    // Keep the table at most half full.
+                    if( ( Members.size() ) * 2 > Slots.size() ) {
+                        Rehash( Slots.size() * 2 );
+                        return;
+                    }
+                    const size_t mask = Slots.size() - 1;
+                    size_t i = h & mask;
+                    while( Slots[i].Pos )
+                        i = ( i + 1 ) & mask;
+                    Slots[i] = Slot{ uint32_t( h ), uint32_t( pos + 1 ) };
+                }
+
+                void Rehash( size_t count ) {
+                    Slots.assign( count, Slot{ 0, 0 } );
+                    const size_t mask = count - 1;
+                    for( size_t pos = 0; pos < Members.size(); ++pos ) {
+                        const size_t h = Hash( Members[pos].first );
+                        size_t i = h & mask;
+                        while( Slots[i].Pos )
+                            i = ( i + 1 ) & mask;
+                        Slots[i] = Slot{ uint32_t( h ), uint32_t( pos + 1 ) };
+                    }
+                }
+
+                std::pmr::vector<value_type> Members;
+                std::pmr::vector<Slot>       Slots;
+        };
+
+        /**
+         *  A toml-test leaf, {"type": Tag, "value": Value}, without the
+         *  object around it: no member table or keys, just the two String
+         *  nodes, in plain text, so const at() can hand them out. Defined
+         *  after JSON, which it holds.
+         */
+        struct TaggedType {
+            using allocator_type = std::pmr::polymorphic_allocator<char>;
+
+            explicit TaggedType( const allocator_type &alloc )
+                : TaggedType( string_view(), string_view(), alloc ) {}
+
+            TaggedType( string_view tag, string_view value, const allocator_type &alloc );
+            TaggedType( const TaggedType &other, const allocator_type &alloc );
+            ~TaggedType();
+
+            TaggedType( const TaggedType & ) = delete;
+            TaggedType &operator=( const TaggedType & ) = delete;
+
+            allocator_type get_allocator() const { return Alloc; }
+
+            JSON          *Members;     // "type", then "value"
+            allocator_type Alloc;
+        };
+
+    private:
     union BackingData {
         BackingData( double d ) : Float( d ){}
         BackingData( long   l ) : Int( l ){}
         BackingData( bool   b ) : Bool( b ){}
-        BackingData( string s ) : String( new string( s ) ){}
+        BackingData( StringType *s ) : String( s ){}
         BackingData()           : Int( 0 ){}
 
-        deque<JSON>        *List;
-        map<string,JSON>   *Map;
-        string             *String;
+        ArrayType          *List;
+        ObjectType         *Map;
+        TaggedType         *Tagged;
+        StringType         *String;
+        const char         *View;
         double              Float;
         long                Int;
         bool                Bool;
-    } Internal;
+    };
 
     public:
-        enum class Class {
+        enum class Class : uint8_t {
             Null,
             Object,
             Array,
             String,
             Floating,
             Integral,
-            Boolean
+            Boolean,
+            Tagged      // see JSON::Tagged()
         };
 
         template <typename Container>
@@ -84,45 +532,63 @@ class JSON
                 typename Container::const_iterator end() const { return object ? object->end() : typename Container::const_iterator(); }
         };
 
-        JSON() : Internal(), Type( Class::Null ){}
+        JSON() : Type( Class::Null ), Internal(){}
 
         JSON( initializer_list<JSON> list ) 
             : JSON() 
         {
             SetType( Class::Object );
+            string key;
             for( auto i = list.begin(), e = list.end(); i != e; ++i, ++i )
-                operator[]( i->ToString() ) = *std::next( i );
+                operator[]( i->Unescaped( key ) ) = *std::next( i );
         }
 
-        JSON( JSON&& other )
-            : Internal( other.Internal )
-            , Type( other.Type )
-        { other.Type = Class::Null; other.Internal.Map = nullptr; }
-
-        JSON& operator=( JSON&& other ) {
+        // noexcept, or growing a member or element vector copies every subtree.
+        // Copying Spare, Length and Internal also copies an inline string.
+        JSON( JSON&& other ) noexcept
+            : Type( other.Type )
+            , Flags( other.Flags )
+            , Spare{ other.Spare[0], other.Spare[1] }
+            , Length( other.Length )
+            , Internal( other.Internal )
+        { other.Type = Class::Null; other.Internal.Map = nullptr; other.Flags = 0; }
+
+        JSON& operator=( JSON&& other ) noexcept {
             ClearInternal();
-            Internal = other.Internal;
             Type = other.Type;
+            Flags = other.Flags;
+            Spare[0] = other.Spare[0];
+            Spare[1] = other.Spare[1];
+            Length = other.Length;
+            Internal = other.Internal;
             other.Internal.Map = nullptr;
             other.Type = Class::Null;
+            other.Flags = 0;
             return *this;
         }
 
+        /// Copies own all of their data; string views are copied into new
+        /// strings, and numbers that kept their text keep just the value.
         JSON( const JSON &other ) {
+            Flags = other.Flags & ( EscapedBit | PlainBit );
             switch( other.Type ) {
             case Class::Object:
-                Internal.Map = 
-                    new map<string,JSON>( other.Internal.Map->begin(),
-                                          other.Internal.Map->end() );
+                Internal.Map = Create<ObjectType>( *other.Internal.Map );
                 break;
             case Class::Array:
-                Internal.List = 
-                    new deque<JSON>( other.Internal.List->begin(),
-                                      other.Internal.List->end() );
+                Internal.List = Create<ArrayType>( *other.Internal.List );
+                break;
+            case Class::Tagged:
+                Internal.Tagged = Create<TaggedType>( *other.Internal.Tagged );
                 break;
             case Class::String:
-                Internal.String = 
-                    new string( *other.Internal.String );
+                StoreString( other.ToStringView() );
+                break;
+            case Class::Floating:
+                Internal.Float = other.ToFloat();
+                break;
+            case Class::Integral:
+                Internal.Int = other.ToInt();
                 break;
             default:
                 Internal = other.Internal;
@@ -131,57 +597,28 @@ class JSON
         }
 
         JSON& operator=( const JSON &other ) {
-            ClearInternal();
-            switch( other.Type ) {
-            case Class::Object:
-                Internal.Map = 
-                    new map<string,JSON>( other.Internal.Map->begin(),
-                                          other.Internal.Map->end() );
-                break;
-            case Class::Array:
-                Internal.List = 
-                    new deque<JSON>( other.Internal.List->begin(),
-                                      other.Internal.List->end() );
-                break;
-            case Class::String:
-                Internal.String = 
-                    new string( *other.Internal.String );
-                break;
-            default:
-                Internal = other.Internal;
-            }
-            Type = other.Type;
-            return *this;
+            // Copy first, other may be one of our own children.
+            JSON copy( other );
+            return *this = std::move( copy );
         }
 
         ~JSON() {
-            switch( Type ) {
-            case Class::Array:
-                delete Internal.List;
-                break;
-            case Class::Object:
-                delete Internal.Map;
-                break;
-            case Class::String:
-                delete Internal.String;
-                break;
-            default:;
-            }
+            ClearInternal();
         }
 
         template <typename T>
-        JSON( T b, typename enable_if<is_same<T,bool>::value>::type* = 0 ) : Internal( b ), Type( Class::Boolean ){}
+        JSON( T b, typename enable_if<is_same<T,bool>::value>::type* = 0 ) : Type( Class::Boolean ), Internal( b ){}
 
         template <typename T>
-        JSON( T i, typename enable_if<is_integral<T>::value && !is_same<T,bool>::value>::type* = 0 ) : Internal( (long)i ), Type( Class::Integral ){}
+        JSON( T i, typename enable_if<is_integral<T>::value && !is_same<T,bool>::value>::type* = 0 ) : Type( Class::Integral ), Internal( (long)i ){}
 
         template <typename T>
-        JSON( T f, typename enable_if<is_floating_point<T>::value>::type* = 0 ) : Internal( (double)f ), Type( Class::Floating ){}
+        JSON( T f, typename enable_if<is_floating_point<T>::value>::type* = 0 ) : Type( Class::Floating ), Internal( (double)f ){}
 
         template <typename T>
-        JSON( T s, typename enable_if<is_convertible<T,string>::value>::type* = 0 ) : Internal( string( s ) ), Type( Class::String ){}
+        JSON( const T &s, typename enable_if<is_string<T>::value>::type* = 0 ) : Type( Class::String ), Flags( InlineBit ) { AssignString( s ); }
 
-        JSON( std::nullptr_t ) : Internal(), Type( Class::Null ){}
+        JSON( std::nullptr_t ) : Type( Class::Null ), Internal(){}
 
         static JSON Make( Class type ) {
             JSON ret; ret.SetType( type );
@@ -190,9 +627,105 @@ class JSON
 
         static JSON Load( const string & );
 
+        /// Load() that stops at the first error and reports it, instead of
+        /// printing it and carrying on. Also rejects anything after the document.
+        static LoadResult TryLoad( const string & );
+
+        /**
+         *  Load() and TryLoad() for large documents, on up to threads
+         *  threads, hardware_concurrency() for 0. A quick scan of just
+         *  strings and nesting finds where the root's members or elements
+         *  start, runs of them are parsed at the same time, and the root
+         *  is put together from the runs in order. The result is the same
+         *  as Load()'s; input that is small, malformed, or not an object
+         *  or array is simply loaded on this thread.
+         *  Nodes built on the other threads come from the heap, even while
+         *  a Document Scope is active.
+         */
+        static JSON LoadParallel( const string &, unsigned threads = 0 );
+        static LoadResult TryLoadParallel( const string &, unsigned threads = 0 );
+
+        /// Padded input lets the parser skip its end of input checks.
+        static JSON Load( const PaddedString & );
+        static LoadResult TryLoad( const PaddedString & );
+
+        /// TryLoad() from a stream, read chunkSize bytes at a time, so only
+        /// about two chunks of the input are in memory at once. See Reader.
+        static LoadResult TryLoad( std::istream &in, size_t chunkSize = 1 << 16 );
+
+        /// Strings this short are kept in the node itself, with no allocation.
+        static constexpr size_t SmallCapacity = 14;
+
+        /**
+         *  A string node for text as it is written between the quotes of
+         *  a JSON string, escapes included. Writer writes it out as it
+         *  is and Unescaped() decodes it. Loaded strings are made this
+         *  way; strings given to the builders are plain text, and are
+         *  escaped when they are written.
+         *  hasEscapes = false promises text contains no backslashes.
+         */
+        static JSON EscapedString( string_view text, bool hasEscapes = true ) {
+            JSON ret( text );
+            ret.Flags |= EscapedBit | ( hasEscapes ? 0 : PlainBit );
+            return ret;
+        }
+
+        /**
+         *  An EscapedString() that refers to str instead of copying it.
+         *  str must outlive the node and anything it is moved into;
+         *  copies of the node get their own string.
+         */
+        static JSON StringView( string_view str, bool hasEscapes = true ) {
+            if( str.size() > UINT32_MAX )
+                return EscapedString( str, hasEscapes );
+            JSON ret;
+            ret.Internal.View = str.data();
+            ret.Length = uint32_t( str.size() );
+            ret.Type = Class::String;
+            ret.Flags = ViewBit | EscapedBit | ( hasEscapes ? 0 : PlainBit );
+            return ret;
+        }
+
+        /**
+         *  A toml-test leaf: what would otherwise be an object with just
+         *  a "type" and a "value" string, in a single small node. Writer
+         *  writes it out as that object. Load() makes one whenever it
+         *  finds that shape. type and value are plain text.
+         *
+         *  hasKey(), size() and const at() treat it as the object it
+         *  stands for, and operator[] turns it into one; ObjectRange()
+         *  has no member table to give, use TagType() and TagValue().
+         */
+        static JSON Tagged( string_view type, string_view value ) {
+            JSON ret;
+            ret.Internal.Tagged = Create<TaggedType>( type, value );
+            ret.Type = Class::Tagged;
+            return ret;
+        }
+
+        /**
+         *  A number node that keeps text, the number as written, rather
+         *  than its value. ToInt() and ToFloat() convert it when asked, and
+         *  Writer writes text back out unchanged. text must be a valid JSON
+         *  number and outlive the node; copies keep only the value.
+         */
+        static JSON NumberView( string_view text ) {
+            long i;
+            const bool integral = text.find_first_of( ".eE" ) == string_view::npos && IntFromText( text, i );
+            if( text.size() > UINT32_MAX )
+                return integral ? JSON( i ) : JSON( FloatFromText( text ) );
+
+            JSON ret;
+            ret.Internal.View = text.data();
+            ret.Length = uint32_t( text.size() );
+            ret.Type = integral ? Class::Integral : Class::Floating;
+            ret.Flags = ViewBit;
+            return ret;
+        }
+
         template <typename T>
         void append( T arg ) {
-            SetType( Class::Array ); Internal.List->emplace_back( arg );
+            SetType( Class::Array ); Internal.List->emplace_back( std::move( arg ) );
         }
 
         template <typename T, typename... U>
@@ -207,20 +740,22 @@ class JSON
 
         template <typename T>
             typename enable_if<is_integral<T>::value && !is_same<T,bool>::value, JSON&>::type operator=( T i ) {
-                SetType( Class::Integral ); Internal.Int = i; return *this;
+                SetType( Class::Integral ); Internal.Int = i; Flags = 0; return *this;
             }
 
         template <typename T>
             typename enable_if<is_floating_point<T>::value, JSON&>::type operator=( T f ) {
-                SetType( Class::Floating ); Internal.Float = f; return *this;
+                SetType( Class::Floating ); Internal.Float = f; Flags = 0; return *this;
             }
 
         template <typename T>
-            typename enable_if<is_convertible<T,string>::value, JSON&>::type operator=( T s ) {
-                SetType( Class::String ); *Internal.String = string( s ); return *this;
+            typename enable_if<is_string<T>::value, JSON&>::type operator=( const T &s ) {
+                SetType( Class::String ); AssignString( s ); return *this;
             }
 
-        JSON& operator[]( const string &key ) {
+        JSON& operator[]( string_view key ) {
+            if( Type == Class::Tagged )
+                Expand();
             SetType( Class::Object ); return Internal.Map->operator[]( key );
         }
 
@@ -230,12 +765,22 @@ class JSON
             return Internal.List->operator[]( index );
         }
 
-        JSON &at( const string &key ) {
+        JSON &at( string_view key ) {
             return operator[]( key );
         }
 
-        const JSON &at( const string &key ) const {
-            return Internal.Map->at( key );
+        const JSON &at( string_view key ) const {
+            if( Type == Class::Tagged ) {
+                if( key == "type" )
+                    return Internal.Tagged->Members[0];
+                if( key == "value" )
+                    return Internal.Tagged->Members[1];
+                throw std::out_of_range( "json::JSON::at: no such key" );
+            }
+            auto it = Internal.Map->find( key );
+            if( it == Internal.Map->end() )
+                throw std::out_of_range( "json::JSON::at: no such key" );
+            return it->second;
         }
 
         JSON &at( unsigned index ) {
@@ -246,6 +791,15 @@ class JSON
             return Internal.List->at( index );
         }
 
+        /// Makes room for n elements of an Array, or n members of an
+        /// Object, so adding them doesn't reallocate. Other nodes ignore it.
+        void reserve( size_t n ) {
+            if( Type == Class::Array )
+                Internal.List->reserve( n );
+            else if( Type == Class::Object )
+                Internal.Map->reserve( n );
+        }
+
         int length() const {
             if( Type == Class::Array )
                 return Internal.List->size();
@@ -253,15 +807,19 @@ class JSON
                 return -1;
         }
 
-        bool hasKey( const string &key ) const {
+        bool hasKey( string_view key ) const {
             if( Type == Class::Object )
                 return Internal.Map->find( key ) != Internal.Map->end();
+            if( Type == Class::Tagged )
+                return key == "type" || key == "value";
             return false;
         }
 
         int size() const {
             if( Type == Class::Object )
                 return Internal.Map->size();
+            else if( Type == Class::Tagged )
+                return 2;
             else if( Type == Class::Array )
                 return Internal.List->size();
             else
@@ -273,22 +831,74 @@ class JSON
         /// Functions for getting primitives from the JSON object.
         bool IsNull() const { return Type == Class::Null; }
 
+        /// The string as JSON text, escapes included.
         string ToString() const { bool b; return std::move( ToString( b ) ); }
         string ToString( bool &ok ) const {
             ok = (Type == Class::String);
-            return ok ? std::move( json_escape( *Internal.String ) ): string("");
+            if( !ok )
+                return string("");
+            return IsEscaped() ? string( ToStringView() ) : json_escape( ToStringView() );
+        }
+
+        /// The string as stored, without copying it: JSON text for an
+        /// EscapedString(), such as a loaded string, otherwise plain text.
+        string_view ToStringView() const { bool b; return ToStringView( b ); }
+        string_view ToStringView( bool &ok ) const {
+            ok = (Type == Class::String);
+            if( !ok )
+                return string_view();
+            if( Flags & InlineBit )
+                return string_view( SmallText(), Flags >> SmallShift );
+            if( Flags & ViewBit )
+                return string_view( Internal.View, Length );
+            return string_view( *Internal.String );
         }
 
+        /// The string with its JSON escapes decoded. Returns the stored string
+        /// when there is nothing to decode, otherwise decodes into buffer.
+        string_view Unescaped( string &buffer ) const;
+
+        /// True for nodes that refer to memory they don't own: string views,
+        /// and numbers that kept their text.
+        bool IsView() const { return ( Flags & ViewBit ) != 0; }
+
+        /// True for strings stored as JSON text; see EscapedString().
+        bool IsEscaped() const { return ( Flags & EscapedBit ) != 0; }
+
         double ToFloat() const { bool b; return ToFloat( b ); }
         double ToFloat( bool &ok ) const {
             ok = (Type == Class::Floating);
-            return ok ? Internal.Float : 0.0;
+            if( !ok )
+                return 0.0;
+            return ( Flags & ViewBit ) ? FloatFromText( NumberText() ) : Internal.Float;
         }
 
         long ToInt() const { bool b; return ToInt( b ); }
         long ToInt( bool &ok ) const {
             ok = (Type == Class::Integral);
-            return ok ? Internal.Int : 0;
+            if( !ok )
+                return 0;
+            if( !( Flags & ViewBit ) )
+                return Internal.Int;
+            long i = 0;
+            IntFromText( NumberText(), i );
+            return i;
+        }
+
+        /// The number as written, for numbers that kept their text
+        /// (see NumberView()); empty for everything else.
+        string_view NumberText() const {
+            if( ( Type == Class::Floating || Type == Class::Integral ) && ( Flags & ViewBit ) )
+                return string_view( Internal.View, Length );
+            return string_view();
+        }
+
+        /// The "type" and "value" of a Tagged() node; empty for anything else.
+        string_view TagType() const {
+            return Type == Class::Tagged ? Internal.Tagged->Members[0].ToStringView() : string_view();
+        }
+        string_view TagValue() const {
+            return Type == Class::Tagged ? Internal.Tagged->Members[1].ToStringView() : string_view();
         }
 
         bool ToBool() const { bool b; return ToBool( b ); }
@@ -297,91 +907,61 @@ class JSON
             return ok ? Internal.Bool : false;
         }
 
-        JSONWrapper<map<string,JSON>> ObjectRange() {
+        JSONWrapper<ObjectType> ObjectRange() {
             if( Type == Class::Object )
-                return JSONWrapper<map<string,JSON>>( Internal.Map );
-            return JSONWrapper<map<string,JSON>>( nullptr );
+                return JSONWrapper<ObjectType>( Internal.Map );
+            return JSONWrapper<ObjectType>( nullptr );
         }
 
-        JSONWrapper<deque<JSON>> ArrayRange() {
+        JSONWrapper<ArrayType> ArrayRange() {
             if( Type == Class::Array )
-                return JSONWrapper<deque<JSON>>( Internal.List );
-            return JSONWrapper<deque<JSON>>( nullptr );
+                return JSONWrapper<ArrayType>( Internal.List );
+            return JSONWrapper<ArrayType>( nullptr );
         }
 
-        JSONConstWrapper<map<string,JSON>> ObjectRange() const {
+        JSONConstWrapper<ObjectType> ObjectRange() const {
             if( Type == Class::Object )
-                return JSONConstWrapper<map<string,JSON>>( Internal.Map );
-            return JSONConstWrapper<map<string,JSON>>( nullptr );
+                return JSONConstWrapper<ObjectType>( Internal.Map );
+            return JSONConstWrapper<ObjectType>( nullptr );
         }
 
 
-        JSONConstWrapper<deque<JSON>> ArrayRange() const { 
+        JSONConstWrapper<ArrayType> ArrayRange() const { 
             if( Type == Class::Array )
-                return JSONConstWrapper<deque<JSON>>( Internal.List );
-            return JSONConstWrapper<deque<JSON>>( nullptr );
-        }
-
-        string dump( int depth = 1, string tab = "  ") const {
-            string pad = "";
-            for( int i = 0; i < depth; ++i, pad += tab );
-
-            switch( Type ) {
-                case Class::Null:
-                    return "null";
-                case Class::Object: {
-                    string s = "{\n";
-                    bool skip = true;
-                    for( auto &p : *Internal.Map ) {
-                        if( !skip ) s += ",\n";
-                        s += ( pad + "\"" + p.first + "\" : " + p.second.dump( depth + 1, tab ) );
-                        skip = false;
-                    }
-                    s += ( "\n" + pad.erase( 0, 2 ) + "}" ) ;
-                    return s;
-                }
-                case Class::Array: {
-                    string s = "[";
-                    bool skip = true;
-                    for( auto &p : *Internal.List ) {
-                        if( !skip ) s += ", ";
-                        s += p.dump( depth + 1, tab );
-                        skip = false;
-                    }
-                    s += "]";
-                    return s;
-                }
-                case Class::String:
-                    return "\"" + json_escape( *Internal.String ) + "\"";
-                case Class::Floating:
-                    return std::to_string( Internal.Float );
-                case Class::Integral:
-                    return std::to_string( Internal.Int );
-                case Class::Boolean:
-                    return Internal.Bool ? "true" : "false";
-                default:
-                    return "";
-            }
-            return "";
+                return JSONConstWrapper<ArrayType>( Internal.List );
+            return JSONConstWrapper<ArrayType>( nullptr );
         }
 
+        /// Serializes into a string; see json::Writer for streaming output.
+        string dump( int depth = 1, string tab = "  " ) const;
+
         friend std::ostream& operator<<( std::ostream&, const JSON & );
 
     private:
+        // Turns a Tagged node into the object it stands for.
+        void Expand() {
+            const JSON tagged( std::move( *this ) );
+            SetType( Class::Object );
+            Internal.Map->operator[]( "type" ) = tagged.TagType();
+            Internal.Map->operator[]( "value" ) = tagged.TagValue();
+        }
+
         void SetType( Class type ) {
             if( type == Type )
                 return;
 
             ClearInternal();
+            Flags = 0;
           
             switch( type ) {
             case Class::Null:      Internal.Map    = nullptr;                break;
-            case Class::Object:    Internal.Map    = new map<string,JSON>(); break;
-            case Class::Array:     Internal.List   = new deque<JSON>();     break;
-            case Class::String:    Internal.String = new string();           break;
+            case Class::Object:    Internal.Map    = Create<ObjectType>();  break;
+            case Class::Array:     Internal.List   = Create<ArrayType>();   break;
+            case Class::String:    Flags = InlineBit;                        break;
             case Class::Floating:  Internal.Float  = 0.0;                    break;
             case Class::Integral:  Internal.Int    = 0;                      break;
             case Class::Boolean:   Internal.Bool   = false;                  break;
+            case Class::Tagged:    Internal.Tagged = Create<TaggedType>();  break;
             }
 
             Type = type;
@@ -394,232 +974,2344 @@ class JSON
       */
       void ClearInternal() {
         switch( Type ) {
-          case Class::Object: delete Internal.Map;    break;
-          case Class::Array:  delete Internal.List;   break;
-          case Class::String: delete Internal.String; break;
+          case Class::Object: Destroy( Internal.Map );    break;
+          case Class::Array:  Destroy( Internal.List );   break;
+          case Class::Tagged: Destroy( Internal.Tagged ); break;
+          case Class::String: if( !( Flags & ( ViewBit | InlineBit ) ) ) Destroy( Internal.String ); break;
           default:;
         }
       }
 
     private:
+        friend class Document;
+
+        /// Where new storage comes from on this thread; see json::Document.
+        static std::pmr::memory_resource *&CurrentResource() {
+            static thread_local std::pmr::memory_resource *resource = std::pmr::new_delete_resource();
+            return resource;
+        }
+
+        template <typename T, typename... Args>
+        static T *Create( Args&&... args ) {
+            auto *resource = CurrentResource();
+            void *mem = resource->allocate( sizeof( T ), alignof( T ) );
+            try {
+                return ::new( mem ) T( std::forward<Args>( args )..., typename T::allocator_type( resource ) );
+            }
+            catch( ... ) {
+                resource->deallocate( mem, sizeof( T ), alignof( T ) );
+                throw;
+            }
+        }
+
+        /// Storage goes back to the resource it was allocated from,
+        /// which is not necessarily the current one.
+        template <typename T>
+        static void Destroy( T *obj ) {
+            auto *resource = obj->get_allocator().resource();
+            obj->~T();
+            resource->deallocate( obj, sizeof( T ), alignof( T ) );
+        }
+
+        // An inline string starts at Spare and runs on over Length and Internal.
+        char *SmallText() {
+            static_assert( offsetof( JSON, Spare ) + SmallCapacity == sizeof( JSON ), "inline strings fill the node" );
+            return reinterpret_cast<char*>( this ) + offsetof( JSON, Spare );
+        }
+        const char *SmallText() const {
+            return reinterpret_cast<const char*>( this ) + offsetof( JSON, Spare );
+        }
+
+        // Stores s in a node that holds no string, keeping the escape flags.
+        void StoreString( string_view s ) {
+            if( s.size() <= SmallCapacity ) {
+                std::memmove( SmallText(), s.data(), s.size() );
+                Flags = uint8_t( ( Flags & ( EscapedBit | PlainBit ) ) | InlineBit | ( s.size() << SmallShift ) );
+            }
+            else {
+                Internal.String = Create<StringType>( s );
+                Flags &= EscapedBit | PlainBit;
+            }
+        }
+
+        // Replaces the string of a String node with plain text s, which may
+        // point into the string being replaced.
+        template <typename T>
+        void AssignString( const T &s ) {
+            if constexpr( !is_convertible<const T&, string_view>::value ) {
+                AssignString( string_view( string( s ) ) );
+                return;
+            }
+            else {
+                const string_view text( s );
+                if( Flags & ( ViewBit | InlineBit ) ) {
+                    Flags = 0;
+                    StoreString( text );
+                }
+                else if( text.size() > SmallCapacity ) {
+                    Internal.String->assign( text );
+                    Flags = 0;
+                }
+                else {
+                    StringType *old = Internal.String;
+                    Flags = 0;
+                    StoreString( text );
+                    Destroy( old );
+                }
+            }
+        }
+
+        static bool IntFromText( string_view text, long &i ) {
+            return std::from_chars( text.data(), text.data() + text.size(), i ).ec == std::errc();
+        }
+
+        static double FloatFromText( string_view text ) {
+            double d = 0.0;
+            if( std::from_chars( text.data(), text.data() + text.size(), d ).ec == std::errc::result_out_of_range )
+                // from_chars leaves d alone when it over or underflows, strtod saturates.
+                d = std::strtod( string( text ).c_str(), nullptr );
+            return d;
+        }
 
-        Class Type = Class::Null;
+        enum : uint8_t {
+            ViewBit    = 1, // Internal.View is Length chars of memory we don't own
+            PlainBit   = 2, // the escaped string is known to have no escapes in it
+            EscapedBit = 4, // the string is JSON text, escapes included
+            InlineBit  = 8  // the string is in the node, see SmallText(); its size is Flags >> SmallShift
+        };
+        static constexpr unsigned SmallShift = 4;
+
+        // 16 bytes: Type and Flags, then 14 that hold either Length and
+        // Internal or an inline string.
+        Class       Type = Class::Null;
+        uint8_t     Flags = 0;
+        char        Spare[2] = {};
+        uint32_t    Length = 0;
+        BackingData Internal;
 };
 
-JSON Array() {
+static_assert( sizeof( JSON ) == 16, "JSON nodes are 16 bytes" );
+
+inline JSON::TaggedType::TaggedType( string_view tag, string_view value, const allocator_type &alloc )
+    : Members( static_cast<JSON*>( alloc.resource()->allocate( 2 * sizeof( JSON ), alignof( JSON ) ) ) ), Alloc( alloc )
+{
+    ::new( Members ) JSON( tag );
+    try {
+        ::new( Members + 1 ) JSON( value );
+    }
+    catch( ... ) {
+        Members[0].~JSON();
+        Alloc.resource()->deallocate( Members, 2 * sizeof( JSON ), alignof( JSON ) );
+        throw;
+    }
+}
+
+inline JSON::TaggedType::TaggedType( const TaggedType &other, const allocator_type &alloc )
+    : TaggedType( other.Members[0].ToStringView(), other.Members[1].ToStringView(), alloc ) {}
+
+inline JSON::TaggedType::~TaggedType() {
+    Members[1].~JSON();
+    Members[0].~JSON();
+    Alloc.resource()->deallocate( Members, 2 * sizeof( JSON ), alignof( JSON ) );
+}
+
+inline JSON Array() {
     return std::move( JSON::Make( JSON::Class::Array ) );
 }
 
 template <typename... T>
 JSON Array( T... args ) {
     JSON arr = JSON::Make( JSON::Class::Array );
+    arr.reserve( sizeof...( args ) );
     arr.append( args... );
     return std::move( arr );
 }
 
-JSON Object() {
+inline JSON Object() {
     return std::move( JSON::Make( JSON::Class::Object ) );
 }
 
-std::ostream& operator<<( std::ostream &os, const JSON &json ) {
-    os << json.dump();
-    return os;
-}
+struct LoadResult {
+    JSON       Value;   // Null if the load failed
+    ParseError Error;
+
+    bool Ok() const { return !Error; }
+};
 
 namespace {
-    JSON parse_next( const string &, size_t & );
+    // Value of 4 hex digits, or -1.
+    inline long hex4( const char *p ) {
+        long v = 0;
+        for( int i = 0; i < 4; ++i ) {
+            const char c = p[i];
+            v <<= 4;
+            if( c >= '0' && c <= '9' )      v |= c - '0';
+            else if( c >= 'a' && c <= 'f' ) v |= c - 'a' + 10;
+            else if( c >= 'A' && c <= 'F' ) v |= c - 'A' + 10;
+            else return -1;
+        }
+        return v;
+    }
 
-    void consume_ws( const string &str, size_t &offset ) {
-        while( isspace( str[offset] ) ) ++offset;
+    inline void append_utf8( string &out, unsigned long cp ) {
+        if( cp < 0x80 )
+            out.push_back( char( cp ) );
+        else if( cp < 0x800 ) {
+            out.push_back( char( 0xC0 | ( cp >> 6 ) ) );
+            out.push_back( char( 0x80 | ( cp & 0x3F ) ) );
+        }
+        else if( cp < 0x10000 ) {
+            out.push_back( char( 0xE0 | ( cp >> 12 ) ) );
+            out.push_back( char( 0x80 | ( ( cp >> 6 ) & 0x3F ) ) );
+            out.push_back( char( 0x80 | ( cp & 0x3F ) ) );
+        }
+        else {
+            out.push_back( char( 0xF0 | ( cp >> 18 ) ) );
+            out.push_back( char( 0x80 | ( ( cp >> 12 ) & 0x3F ) ) );
+            out.push_back( char( 0x80 | ( ( cp >> 6 ) & 0x3F ) ) );
+            out.push_back( char( 0x80 | ( cp & 0x3F ) ) );
+        }
     }
+}
 
-    JSON parse_object( const string &str, size_t &offset ) {
-        JSON Object = JSON::Make( JSON::Class::Object );
+/**
+ *  Decodes the JSON escapes in str.
+ *
+ *  Returns str itself when it has no escapes, so the common case doesn't
+ *  copy. Otherwise the decoded string is built in buffer, and the view
+ *  returned refers to it. Malformed escapes are kept as they are.
+ */
+inline string_view Unescape( string_view str, string &buffer ) {
+    size_t i = str.find( '\\' );
+    if( i == string_view::npos )
+        return str;
 
-        ++offset;
-        consume_ws( str, offset );
-        if( str[offset] == '}' ) {
-            ++offset; return std::move( Object );
+    buffer.assign( str.data(), i );
+    while( i < str.size() ) {
+        const size_t next = str.find( '\\', i );
+        if( next != i ) {
+            const size_t stop = next == string_view::npos ? str.size() : next;
+            buffer.append( str.data() + i, stop - i );
+            i = stop;
+            continue;
+        }
+        if( i + 1 == str.size() ) {
+            buffer.push_back( '\\' );
+            break;
         }
 
-        while( true ) {
-            JSON Key = parse_next( str, offset );
-            consume_ws( str, offset );
-            if( str[offset] != ':' ) {
-                std::cerr << "Error: Object: Expected colon, found '" << str[offset] << "'\n";
-                break;
-            }
-            consume_ws( str, ++offset );
-            JSON Value = parse_next( str, offset );
-            Object[Key.ToString()] = Value;
-            
-            consume_ws( str, offset );
-            if( str[offset] == ',' ) {
-                ++offset; continue;
-            }
-            else if( str[offset] == '}' ) {
-                ++offset; break;
-            }
-            else {
-                std::cerr << "ERROR: Object: Expected comma, found '" << str[offset] << "'\n";
+        const char e = str[i + 1];
+        i += 2;
+        switch( e ) {
+            case '"':  buffer.push_back( '"' );  break;
+            case '\\': buffer.push_back( '\\' ); break;
+            case '/':  buffer.push_back( '/' );  break;
+            case 'b':  buffer.push_back( '\b' ); break;
+            case 'f':  buffer.push_back( '\f' ); break;
+            case 'n':  buffer.push_back( '\n' ); break;
+            case 'r':  buffer.push_back( '\r' ); break;
+            case 't':  buffer.push_back( '\t' ); break;
+            case 'u': {
+                long cp = i + 4 <= str.size() ? hex4( str.data() + i ) : -1;
+                if( cp < 0 ) {
+                    buffer.append( "\\u", 2 );
+                    break;
+                }
+                i += 4;
+                // Surrogate pairs come as two escapes.
+                if( cp >= 0xD800 && cp < 0xDC00 && i + 6 <= str.size() &&
+                    str[i] == '\\' && str[i + 1] == 'u' ) {
+                    const long low = hex4( str.data() + i + 2 );
+                    if( low >= 0xDC00 && low < 0xE000 ) {
+                        cp = 0x10000 + ( ( cp - 0xD800 ) << 10 ) + ( low - 0xDC00 );
+                        i += 6;
+                    }
+                }
+                append_utf8( buffer, cp );
                 break;
             }
+            default:
+                buffer.push_back( '\\' );
+                buffer.push_back( e );
         }
-
-        return std::move( Object );
     }
+    return buffer;
+}
 
-    JSON parse_array( const string &str, size_t &offset ) {
-        JSON Array = JSON::Make( JSON::Class::Array );
-        unsigned index = 0;
-        
-        ++offset;
-        consume_ws( str, offset );
-        if( str[offset] == ']' ) {
-            ++offset; return std::move( Array );
-        }
+inline string_view JSON::Unescaped( string &buffer ) const {
+    const string_view str = ToStringView();
+    if( ( Flags & PlainBit ) || !( Flags & EscapedBit ) )
+        return str;
+    return Unescape( str, buffer );
+}
 
-        while( true ) {
-            Array[index++] = parse_next( str, offset );
-            consume_ws( str, offset );
+/**
+ *  Single pass JSON serializer.
+ *
+ *  Output goes straight into a caller supplied string, or into a
+ *  fixed size staging buffer that is flushed to a std::ostream, so
+ *  no temporary strings are built per node. Plain text strings are
+ *  escaped as they are copied in, see escape_into(). Documents can be
+ *  written from a JSON tree with Value(), or piece by piece with the
+ *  Begin/End/Key/scalar calls.
+ */
+class Writer
+{
+    public:
+        enum class Style {
+            Compact,
+            Pretty
+        };
 
-            if( str[offset] == ',' ) {
-                ++offset; continue;
-            }
-            else if( str[offset] == ']' ) {
-                ++offset; break;
-            }
-            else {
-                std::cerr << "ERROR: Array: Expected ',' or ']', found '" << str[offset] << "'\n";
-                return std::move( JSON::Make( JSON::Class::Array ) );
-            }
-        }
+        Writer( string &out, Style style = Style::Pretty, string tab = "  " )
+            : Out( &out ), Stream( nullptr ), Format( style ), Tab( std::move( tab ) ) {}
 
-        return std::move( Array );
-    }
+        Writer( std::ostream &os, Style style = Style::Pretty, string tab = "  " )
+            : Out( &Staging ), Stream( &os ), Format( style ), Tab( std::move( tab ) )
+        { Staging.reserve( FlushSize + 256 ); }
 
-    JSON parse_string( const string &str, size_t &offset ) {
-        JSON String;
-        string val;
-        while (str[++offset] != '\"')
-        {
-            if (str[offset] == '\\' &&
-                str[offset + 1] == '\\')
+        Writer( const Writer & ) = delete;
+        Writer& operator=( const Writer & ) = delete;
 
-            {
-                val += "\\\\";
-                ++offset;
-            }
-            else if (str[offset] == '\\' &&
-                str[offset + 1] == '\"')
-            {
-                val += "\\\"";
-                ++offset;
-            }
+        ~Writer() { Flush(); }
+
+        /// Sets the nesting depth used for indentation, as dump( depth ) does.
+        void SetDepth( int depth ) { Depth = depth; }
+
+        void BeginObject() { Open( '{', true ); }
+        void EndObject()   { Close( '}' ); }
+        void BeginArray()  { Open( '[', false ); }
+        void EndArray()    { Close( ']' ); }
+
+        void Key( string_view key ) {
+            Separate();
+            Quoted( key );
+            if( Format == Style::Pretty )
+                Out->append( " : ", 3 );
             else
-                val.push_back(str[offset]);
+                Out->push_back( ':' );
+            AfterKey = true;
         }
-        ++offset;
-        String = val;
-        return std::move( String );
-    }
 
-    JSON parse_number( const string &str, size_t &offset ) {
-        JSON Number;
-        string val, exp_str;
-        char c;
-        bool isDouble = false;
-        long exp = 0;
-        while( true ) {
-            c = str[offset++];
-            if( (c == '-') || (c >= '0' && c <= '9') )
-                val += c;
-            else if( c == '.' ) {
-                val += c; 
-                isDouble = true;
+        /// Writes str escaped; see RawString() for text that already is.
+        void String( string_view str ) { Separate(); Quoted( str ); Done(); }
+
+        /// Writes text, which must already be JSON escaped, as a string.
+        void RawString( string_view text ) {
+            Separate();
+            Out->push_back( '\"' );
+            Out->append( text.data(), text.size() );
+            Out->push_back( '\"' );
+            Done();
+        }
+
+        void Int( long i ) {
+            char buf[24];
+            auto res = std::to_chars( buf, buf + sizeof( buf ), i );
+            Separate(); Out->append( buf, res.ptr ); Done();
+        }
+
+        /// Shortest text that reads back as f, always with a '.' or an
+        /// exponent so it reads back as a float.
+        void Float( double f ) {
+            char buf[32];
+            auto res = std::to_chars( buf, buf + sizeof( buf ) - 2, f );
+            if( std::find_if( buf, res.ptr, []( char c ){ return c == '.' || c == 'e' || c == 'n'; } ) == res.ptr ) {
+                *res.ptr++ = '.';
+                *res.ptr++ = '0';
             }
-            else
-                break;
+            Separate(); Out->append( buf, res.ptr ); Done();
         }
-        if( c == 'E' || c == 'e' ) {
-            c = str[ offset++ ];
-            if( c == '-' ){ ++offset; exp_str += '-';}
-            while( true ) {
-                c = str[ offset++ ];
-                if( c >= '0' && c <= '9' )
-                    exp_str += c;
-                else if( !isspace( c ) && c != ',' && c != ']' && c != '}' ) {
-                    std::cerr << "ERROR: Number: Expected a number for exponent, found '" << c << "'\n";
-                    return std::move( JSON::Make( JSON::Class::Null ) );
+
+        /// Writes text, which must be a JSON number, as it is.
+        void Number( string_view text ) { Separate(); Out->append( text.data(), text.size() ); Done(); }
+
+        void Bool( bool b ) {
+            Separate();
+            if( b ) Out->append( "true", 4 );
+            else    Out->append( "false", 5 );
+            Done();
+        }
+
+        void Null() { Separate(); Out->append( "null", 4 ); Done(); }
+
+        /// Writes a whole JSON tree.
+        void Value( const JSON & );
+
+        /// Pushes anything staged to the output stream.
+        void Flush() {
+            if( Stream && !Staging.empty() ) {
+                Stream->write( Staging.data(), Staging.size() );
+                Staging.clear();
+            }
+        }
+
+    private:
+        static constexpr size_t FlushSize = 1 << 16;
+
+        void Open( char c, bool object ) {
+            Separate();
+            Out->push_back( c );
+            Scopes.push_back( object );
+            ++Depth;
+            First = true;
+        }
+
+        void Close( char c ) {
+            --Depth;
+            // Objects put their closing brace on its own line, arrays stay inline.
+            if( Scopes.back() && Format == Style::Pretty && !First ) {
+                Out->push_back( '\n' );
+                Indent( Depth );
+            }
+            Scopes.pop_back();
+            Out->push_back( c );
+            Done();
+        }
+
+        // Emits whatever has to come between the previous token and the next one.
+        void Separate() {
+            if( AfterKey ) {
+                AfterKey = false;
+                return;
+            }
+            if( Scopes.empty() )
+                return;
+
+            if( Format == Style::Pretty ) {
+                if( Scopes.back() ) {
+                    Out->append( First ? "\n" : ",\n" );
+                    Indent( Depth );
                 }
-                else
-                    break;
+                else if( !First )
+                    Out->append( ", ", 2 );
             }
-            exp = std::stol( exp_str );
+            else if( !First )
+                Out->push_back( ',' );
         }
-        else if( !isspace( c ) && c != ',' && c != ']' && c != '}' ) {
-            std::cerr << "ERROR: Number: unexpected character '" << c << "'\n";
-            return std::move( JSON::Make( JSON::Class::Null ) );
+
+        void Done() {
+            First = false;
+            if( Stream && Staging.size() >= FlushSize )
+                Flush();
         }
-        --offset;
-        
-        if( isDouble )
-            Number = std::stod( val ) * std::pow( 10, exp );
-        else {
-            if( !exp_str.empty() )
-                Number = std::stol( val ) * std::pow( 10, exp );
+
+        void Indent( int depth ) {
+            const size_t n = depth * Tab.size();
+            while( Pad.size() < n )
+                Pad += Tab;
+            Out->append( Pad.data(), n );
+        }
+
+        void Quoted( string_view str ) {
+            Out->push_back( '\"' );
+            escape_into( *Out, str );
+            Out->push_back( '\"' );
+        }
+
+        string  *Out;
+        std::ostream *Stream;
+        string   Staging;
+        Style    Format;
+        string   Tab;
+        string   Pad;
+        vector<bool> Scopes;
+        int      Depth = 0;
+        bool     First = true;
+        bool     AfterKey = false;
+};
+
+inline void Writer::Value( const JSON &json ) {
+    switch( json.JSONType() ) {
+        case JSON::Class::Null:
+            Null();
+            break;
+        case JSON::Class::Object:
+            BeginObject();
+            for( auto &p : json.ObjectRange() ) {
+                Key( p.first );
+                Value( p.second );
+            }
+            EndObject();
+            break;
+        case JSON::Class::Array:
+            BeginArray();
+            for( auto &p : json.ArrayRange() )
+                Value( p );
+            EndArray();
+            break;
+        case JSON::Class::String:
+            if( json.IsEscaped() )
+                RawString( json.ToStringView() );
             else
-                Number = std::stol( val );
+                String( json.ToStringView() );
+            break;
+        case JSON::Class::Floating:
+            if( json.IsView() )
+                Number( json.NumberText() );
+            else
+                Float( json.ToFloat() );
+            break;
+        case JSON::Class::Integral:
+            if( json.IsView() )
+                Number( json.NumberText() );
+            else
+                Int( json.ToInt() );
+            break;
+        case JSON::Class::Boolean:
+            Bool( json.ToBool() );
+            break;
+        case JSON::Class::Tagged:
+            BeginObject();
+            Key( "type" );
+            String( json.TagType() );
+            Key( "value" );
+            String( json.TagValue() );
+            EndObject();
+            break;
+    }
+}
+
+inline string JSON::dump( int depth, string tab ) const {
+    string s;
+    Writer w( s, Writer::Style::Pretty, std::move( tab ) );
+    w.SetDepth( depth - 1 );
+    w.Value( *this );
+    return s;
+}
+
+inline std::ostream& operator<<( std::ostream &os, const JSON &json ) {
+    Writer( os ).Value( json );
+    return os;
+}
+
+/**
+ *  Text followed by Padding zero bytes.
+ *
+ *  The parser's scanning loops read whole vector blocks at a time. With
+ *  the padding in place they can read up to and past the end of the text
+ *  without checking where it stops, and still stay inside the buffer
+ *  however the text is cut short.
+ *
+ *  ReadFile() and ReadStdin() fill one straight from the file
+ *  descriptor. Large regular files are memory mapped instead of read,
+ *  with zero pages mapped in after them for the padding.
+ */
+class PaddedString
+{
+    public:
+        static constexpr size_t Padding = 64;
+
+        /// Smaller files are read; one read() is cheaper than setting up a mapping.
+        static constexpr size_t MapThreshold = 1 << 16;
+
+        PaddedString() = default;
+        explicit PaddedString( string_view text ) { Append( text ); }
+
+        PaddedString( PaddedString &&other ) noexcept
+            : Buffer( std::move( other.Buffer ) ), Size( other.Size ), Capacity( other.Capacity ), Mapped( other.Mapped )
+        { other.Size = other.Capacity = other.Mapped = 0; }
+
+        PaddedString& operator=( PaddedString &&other ) noexcept {
+            Release();
+            Buffer = std::move( other.Buffer );
+            Size = other.Size;
+            Capacity = other.Capacity;
+            Mapped = other.Mapped;
+            other.Size = other.Capacity = other.Mapped = 0;
+            return *this;
+        }
+
+        ~PaddedString() { Release(); }
+
+        /// Reads the whole of a file; throws std::system_error if it can't.
+        static PaddedString ReadFile( const string &path );
+
+        /// Reads the whole of standard input, as ReadFile() does a file.
+        static PaddedString ReadStdin();
+
+        /// Reads everything left in the stream.
+        static PaddedString Read( std::istream &in ) {
+            PaddedString text;
+            std::streambuf *buf = in.rdbuf();
+            while( buf ) {
+                text.Reserve( text.Size + ( 1 << 16 ) );
+                const std::streamsize n = buf->sgetn( text.Buffer.get() + text.Size, std::streamsize( text.Capacity - text.Size ) );
+                if( n <= 0 )
+                    break;
+                text.Size += size_t( n );
+            }
+            text.Pad();
+            return text;
+        }
+
+        void Append( string_view text ) {
+            Reserve( Size + text.size() );
+            if( !text.empty() )
+                std::memcpy( Buffer.get() + Size, text.data(), text.size() );
+            Size += text.size();
+            Pad();
+        }
+
+        /// Drops the first count bytes.
+        void Erase( size_t count ) {
+            count = std::min( count, Size );
+            if( count && count < Size )
+                std::memmove( Buffer.get(), Buffer.get() + count, Size - count );
+            Size -= count;
+            Pad();
+        }
+
+        const char *data() const {
+            static const char none[Padding] = {};
+            return Buffer ? Buffer.get() : none;
+        }
+        size_t size() const { return Size; }
+        bool empty() const { return Size == 0; }
+
+        operator string_view() const { return string_view( data(), Size ); }
+
+        /// True if the text is a memory mapped file.
+        bool IsMapped() const { return Mapped != 0; }
+
+    private:
+#if defined( SIMPLEJSON_POSIX_IO )
+        static PaddedString ReadDescriptor( int fd );
+        bool Map( int fd, size_t size );
+#endif
+
+        void Reserve( size_t size ) {
+            if( size <= Capacity )
+                return;
+            const size_t capacity = std::max( size, Capacity * 2 );
+            std::unique_ptr<char[]> grown( new char[capacity + Padding] );
+            if( Size )
+                std::memcpy( grown.get(), Buffer.get(), Size );
+            Release();
+            Buffer = std::move( grown );
+            Capacity = capacity;
+        }
+
+        // Frees the buffer, however it was made; Size is left to the caller.
+        void Release() {
+#if defined( SIMPLEJSON_POSIX_IO )
+            if( Mapped ) {
+                ::munmap( Buffer.release(), Mapped );
+                Mapped = 0;
+            }
+#endif
+            Buffer.reset();
+            Capacity = 0;
+        }
+
+        void Pad() {
+            if( Buffer )
+                std::memset( Buffer.get() + Size, 0, Padding );
+        }
+
+        std::unique_ptr<char[]> Buffer;
+        size_t Size = 0;
+        size_t Capacity = 0;
+        size_t Mapped = 0;      // length of the mapping, if Buffer is one
+};
+
+#if defined( SIMPLEJSON_POSIX_IO )
+
+inline PaddedString PaddedString::ReadFile( const string &path ) {
+    const int fd = ::open( path.c_str(), O_RDONLY | O_CLOEXEC );
+    if( fd < 0 )
+        throw std::system_error( errno, std::generic_category(), "json::PaddedString::ReadFile: " + path );
+    struct Closer {
+        int fd;
+        ~Closer() { ::close( fd ); }
+    } closer{ fd };
+    return ReadDescriptor( fd );
+}
+
+inline PaddedString PaddedString::ReadStdin() {
+    return ReadDescriptor( STDIN_FILENO );
+}
+
+inline PaddedString PaddedString::ReadDescriptor( int fd ) {
+    PaddedString text;
+    struct stat info;
+    const bool regular = ::fstat( fd, &info ) == 0 && S_ISREG( info.st_mode );
+    if( regular && size_t( info.st_size ) >= MapThreshold && text.Map( fd, size_t( info.st_size ) ) )
+        return text;
+
+    // Pipes and small files. A file's size is known, so its first read
+    // takes it all and the second finds the end, in the byte to spare;
+    // the buffer only grows once it is full.
+    const size_t chunk = regular ? size_t( info.st_size ) + 1 : size_t( 1 ) << 20;
+    for( ;; ) {
+        if( text.Size == text.Capacity )
+            text.Reserve( text.Size + chunk );
+        const ssize_t n = ::read( fd, text.Buffer.get() + text.Size, text.Capacity - text.Size );
+        if( n == 0 )
+            break;
+        if( n < 0 ) {
+            if( errno == EINTR )
+                continue;
+            throw std::system_error( errno, std::generic_category(), "json::PaddedString: read failed" );
         }
-        return std::move( Number );
+        text.Size += size_t( n );
     }
+    text.Pad();
+    return text;
+}
 
-    JSON parse_bool( const string &str, size_t &offset ) {
-        JSON Bool;
-        if( str.substr( offset, 4 ) == "true" )
-            Bool = true;
-        else if( str.substr( offset, 5 ) == "false" )
-            Bool = false;
-        else {
-            std::cerr << "ERROR: Bool: Expected 'true' or 'false', found '" << str.substr( offset, 5 ) << "'\n";
-            return std::move( JSON::Make( JSON::Class::Null ) );
+inline bool PaddedString::Map( int fd, size_t size ) {
+    const size_t page = size_t( ::sysconf( _SC_PAGESIZE ) );
+    const size_t length = ( size + Padding + page - 1 ) / page * page;
+
+    // Zero pages for the whole length, then the file over the front of
+    // them; the end of the file's last page reads as zeros too. The
+    // mapping is private and writable, so LoadInPlace() can write to it.
+    void *area = ::mmap( nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANON, -1, 0 );
+    if( area == MAP_FAILED )
+        return false;
+    if( ::mmap( area, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, fd, 0 ) == MAP_FAILED ) {
+        ::munmap( area, length );
+        return false;
+    }
+    ::posix_madvise( area, size, POSIX_MADV_SEQUENTIAL );
+
+    Buffer.reset( static_cast<char*>( area ) );
+    Mapped = length;
+    Size = size;
+    Capacity = length - Padding;
+    return true;
+}
+
+#else
+
+inline PaddedString PaddedString::ReadFile( const string &path ) {
+    std::ifstream in( path, std::ios::binary );
+    if( !in )
+        throw std::system_error( std::make_error_code( std::errc::no_such_file_or_directory ),
+                                 "json::PaddedString::ReadFile: " + path );
+    return Read( in );
+}
+
+inline PaddedString PaddedString::ReadStdin() {
+    return Read( std::cin );
+}
+
+#endif
+
+/// How Document::LoadInPlace() builds nodes.
+struct LoadOptions {
+    /// Numbers keep the text they were written with, as JSON::NumberView()
+    /// does, instead of being converted while loading.
+    bool KeepNumberText = false;
+};
+
+/**
+ *  Owns the memory for one JSON tree at a time.
+ *
+ *  Load(), and any builder called while a Scope is alive on this
+ *  thread, take their nodes from a bump allocator instead of the
+ *  global heap. Freeing a node is a no-op; the memory comes back all
+ *  at once on Reset(), and the next document reuses it. The first
+ *  block is sized to the largest document seen so far, so a warmed up
+ *  Document parses without touching malloc.
+ *
+ *  Nodes allocated here must not outlive the Document, or be used after
+ *  Reset(). Copy a subtree outside of any Scope to keep it.
+ *  A Document must only be used by one thread at a time.
+ */
+class Document
+{
+    public:
+        /// While alive, new nodes on this thread are allocated from the Document.
+        class Scope {
+            std::pmr::memory_resource *Previous;
+
+            public:
+                explicit Scope( Document &doc ) : Previous( JSON::CurrentResource() ) {
+                    JSON::CurrentResource() = &*doc.Arena;
+                }
+                ~Scope() { JSON::CurrentResource() = Previous; }
+
+                Scope( const Scope & ) = delete;
+                Scope& operator=( const Scope & ) = delete;
+        };
+
+        explicit Document( size_t initialSize = 1 << 16 )
+            : BlockSize( initialSize ), Block( new char[initialSize] )
+        { Arena.emplace( Block.get(), BlockSize, &Heap ); }
+
+        Document( const Document & ) = delete;
+        Document& operator=( const Document & ) = delete;
+
+        /// Resets the document, then parses str into it.
+        JSON &Load( const string &str );
+
+        /**
+         *  Resets the document, then takes str and parses it in place.
+         *  String values are views into the document's copy of str
+         *  rather than copies of their own; they stay valid until the
+         *  next Reset(). Move the input in to avoid copying it at all.
+         */
+        JSON &LoadInPlace( string str, LoadOptions options = {} );
+
+        /// LoadInPlace() for padded input, which parses without end of input checks.
+        JSON &LoadInPlace( PaddedString str, LoadOptions options = {} );
+
+        /// Load() and LoadInPlace() that stop at the first error and return
+        /// it, as JSON::TryLoad() does. Root() is Null after a failure.
+        ParseError TryLoad( const string &str );
+        ParseError TryLoadInPlace( string str, LoadOptions options = {} );
+        ParseError TryLoadInPlace( PaddedString str, LoadOptions options = {} );
+
+        /// Resets the document, then loads it from a stream, chunkSize
+        /// bytes at a time, as JSON::TryLoad( std::istream& ) does.
+        ParseError TryLoad( std::istream &in, size_t chunkSize = 1 << 16 );
+
+        JSON &Root() { return Tree; }
+        const JSON &Root() const { return Tree; }
+
+        /// The text LoadInPlace() took; what its views point into.
+        string_view Input() const {
+            return Source.empty() ? string_view( PaddedSource ) : string_view( Source );
         }
-        offset += (Bool.ToBool() ? 4 : 5);
-        return std::move( Bool );
+
+        Scope Use() { return Scope( *this ); }
+
+        /// Drops the current tree and makes all of its memory available again.
+        void Reset() {
+            Tree = JSON();
+            Source.clear();
+            PaddedSource = PaddedString();
+            Arena.reset();
+            if( Heap.Used ) {
+                BlockSize += Heap.Used;
+                Block.reset( new char[BlockSize] );
+                Heap.Used = 0;
+            }
+            Arena.emplace( Block.get(), BlockSize, &Heap );
+        }
+
+        /// Bytes the next document can use before the arena has to grow.
+        size_t Capacity() const { return BlockSize; }
+
+    private:
+        // Counts what the arena asks for beyond the first block.
+        struct Upstream : std::pmr::memory_resource {
+            size_t Used = 0;
+
+            void *do_allocate( size_t bytes, size_t align ) override {
+                void *p = std::pmr::new_delete_resource()->allocate( bytes, align );
+                Used += bytes;
+                return p;
+            }
+            void do_deallocate( void *p, size_t bytes, size_t align ) override {
+                std::pmr::new_delete_resource()->deallocate( p, bytes, align );
+            }
+            bool do_is_equal( const std::pmr::memory_resource &other ) const noexcept override {
+                return this == &other;
+            }
+        };
+
+        size_t                  BlockSize;
+        std::unique_ptr<char[]> Block;
+        Upstream                Heap;
+        std::optional<std::pmr::monotonic_buffer_resource> Arena;
+        string                  Source;
+        PaddedString            PaddedSource;
+        JSON                    Tree;
+
+        // Parses text into Tree; text is one of the Sources when in place.
+        template <typename Text>
+        ParseError Parse( const Text &text, bool inPlace, LoadOptions options, bool stopAtErrors );
+};
+
+namespace {
+    struct Context;
+    JSON parse_next( Context &, size_t & );
+
+    /// The text being parsed. Reading the byte at size() is always fine:
+    /// a std::string keeps its terminator there, a PaddedString its padding.
+    struct Input {
+        const char *Data;
+        size_t      Size;
+        bool        Padded;
+
+        Input( const string &str ) : Data( str.data() ), Size( str.size() ), Padded( false ) {}
+        Input( const PaddedString &str ) : Data( str.data() ), Size( str.size() ), Padded( true ) {}
+
+        char operator[]( size_t i ) const { return Data[i]; }
+        const char *data() const { return Data; }
+        size_t size() const { return Size; }
+
+        int compare( size_t pos, size_t n, const char *s ) const {
+            return string_view( Data, Size ).compare( pos, n, s );
+        }
+        string_view substr( size_t pos, size_t n ) const {
+            return string_view( Data, Size ).substr( pos, n );
+        }
+    };
+
+    void consume_ws( const Input &str, size_t &offset ) {
+        const char *begin = str.data(), *p = begin + offset, *end = begin + str.size();
+        offset = ( str.Padded ? skip_ws<true>( p, end ) : skip_ws( p, end ) ) - begin;
     }
 
-    JSON parse_null( const string &str, size_t &offset ) {
-        JSON Null;
-        if( str.substr( offset, 4 ) != "null" ) {
-            std::cerr << "ERROR: Null: Expected 'null', found '" << str.substr( offset, 4 ) << "'\n";
-            return std::move( JSON::Make( JSON::Class::Null ) );
+    /// The input, and how nodes should be made from it.
+    struct Context {
+        Input str;
+        bool InPlace;               // strings are views into str instead of copies
+        bool KeepNumberText = false; // numbers are views into str too
+        ParseError *Error = nullptr; // stop at the first error and record it here
+    };
+
+    // Records the first error, and says whether parsing should stop. Without
+    // an Error to record into, Load() prints its message and carries on.
+    inline bool stop( Context &ctx, ErrorCode code, size_t offset ) {
+        if( !ctx.Error )
+            return false;
+        if( !*ctx.Error ) {
+            ctx.Error->Code = code;
+            ctx.Error->Offset = offset;
         }
-        offset += 4;
-        return std::move( Null );
+        return true;
     }
 
-    JSON parse_next( const string &str, size_t &offset ) {
-        char value;
+    inline bool failed( const Context &ctx ) {
+        return ctx.Error && *ctx.Error;
+    }
+
+    // Finds the body of the string opening at str[offset], escapes and all,
+    // and leaves offset just past the closing quote. An unterminated string
+    // runs to the end of str.
+    string_view scan_string( const Input &str, size_t &offset, bool &escapes ) {
+        const char *begin = str.data(), *end = begin + str.size();
+        const char *start = begin + offset + 1, *p = start;
+        escapes = false;
+        while( true ) {
+            p = str.Padded ? find_quote_or_escape<true>( p, end ) : find_quote_or_escape( p, end );
+            if( p >= end ) {
+                offset = str.size();
+                return string_view( start, end - start );
+            }
+            if( *p == '"' )
+                break;
+            if( *p == '\\' ) {
+                // Skipping the whole escape means an escaped quote can't end the string.
+                escapes = true;
+                p += ( end - p ) > 1 ? 2 : 1;
+            }
+            else
+                ++p;    // a zero byte in the string itself
+        }
+        offset = p + 1 - begin;
+        return string_view( start, p - start );
+    }
+
+    inline bool terminated( const Input &str, string_view body ) {
+        return body.data() + body.size() != str.data() + str.size();
+    }
+
+    // The Tagged node for a toml-test leaf with these members, or Null
+    // if they aren't both strings. Escaped text is decoded into buffers
+    // kept for the thread, so only the node's own copy is allocated, from
+    // the current Document's arena when there is one.
+    JSON tagged_leaf( const JSON &type, const JSON &value ) {
+        if( type.JSONType() != JSON::Class::String || value.JSONType() != JSON::Class::String )
+            return JSON();
+        static thread_local string typeBuffer, valueBuffer;
+        return JSON::Tagged( type.Unescaped( typeBuffer ), value.Unescaped( valueBuffer ) );
+    }
+
+    // Swaps a finished object that is just a toml-test leaf for a Tagged node.
+    void tag_leaf( JSON &object ) {
+        const JSON &obj = object;
+        if( obj.size() != 2 || !obj.hasKey( "type" ) || !obj.hasKey( "value" ) )
+            return;
+        JSON leaf = tagged_leaf( obj.at( "type" ), obj.at( "value" ) );
+        if( !leaf.IsNull() )
+            object = std::move( leaf );
+    }
+
+    JSON parse_object( Context &ctx, size_t &offset ) {
+        const Input &str = ctx.str;
+        JSON Object;
+
+        ++offset;
         consume_ws( str, offset );
-        value = str[offset];
-        switch( value ) {
-            case '[' : return std::move( parse_array( str, offset ) );
-            case '{' : return std::move( parse_object( str, offset ) );
-            case '\"': return std::move( parse_string( str, offset ) );
-            case 't' :
-            case 'f' : return std::move( parse_bool( str, offset ) );
-            case 'n' : return std::move( parse_null( str, offset ) );
-            default  : if( ( value <= '9' && value >= '0' ) || value == '-' )
-                           return std::move( parse_number( str, offset ) );
+        if( str[offset] == '}' ) {
+            ++offset; return std::move( JSON::Make( JSON::Class::Object ) );
         }
-        std::cerr << "ERROR: Parse: Unknown starting character '" << value << "'\n";
-        return JSON();
+
+        // "type" and "value" members are held here until another key
+        // turns up, so toml-test leaves never get a member table.
+        std::pair<string_view, JSON> held[2];
+        unsigned heldCount = 0;
+        const auto materialize = [&] {
+            Object = JSON::Make( JSON::Class::Object );
+            for( unsigned i = 0; i < heldCount; ++i )
+                Object[held[i].first] = std::move( held[i].second );
+        };
+
+        string fallback;
+        while( true ) {
+            string_view Key;
+            bool escapes;
+            consume_ws( str, offset );
+            if( str[offset] == '\"' ) {
+                const size_t start = offset;
+                Key = scan_string( str, offset, escapes );
+                if( !terminated( str, Key ) && stop( ctx, ErrorCode::UnterminatedString, start ) )
+                    return JSON();
+                // Keys are kept as plain text, so lookups needn't escape them.
+                if( escapes )
+                    Key = Unescape( Key, fallback );
+            }
+            else if( stop( ctx, offset < str.size() ? ErrorCode::ExpectedKey : ErrorCode::UnexpectedEnd, offset ) )
+                return JSON();
+            else
+                Key = fallback = parse_next( ctx, offset ).ToString();
+            consume_ws( str, offset );
+            if( str[offset] != ':' ) {
+                if( stop( ctx, offset < str.size() ? ErrorCode::ExpectedColon : ErrorCode::UnexpectedEnd, offset ) )
+                    return JSON();
+                std::cerr << "Error: Object: Expected colon, found '" << str[offset] << "'\n";
+                break;
+            }
+            JSON *slot;
+            if( Object.IsNull() && heldCount < 2 && ( Key == "type" || Key == "value" ) &&
+                !( heldCount && held[0].first == Key ) ) {
+                held[heldCount].first = Key == "type" ? "type" : "value";
+                slot = &held[heldCount++].second;
+            }
+            else {
+                if( Object.IsNull() )
+                    materialize();
+                slot = &Object[Key];
+            }
+            JSON &Value = *slot;
+            consume_ws( str, ++offset );
+            Value = parse_next( ctx, offset );
+            if( failed( ctx ) )
+                return JSON();
+            
+            consume_ws( str, offset );
+            if( str[offset] == ',' ) {
+                ++offset; continue;
+            }
+            else if( str[offset] == '}' ) {
+                ++offset; break;
+            }
+            else {
+                if( stop( ctx, offset < str.size() ? ErrorCode::ExpectedCommaOrBrace : ErrorCode::UnexpectedEnd, offset ) )
+                    return JSON();
+                std::cerr << "ERROR: Object: Expected comma, found '" << str[offset] << "'\n";
+                break;
+            }
+        }
+
+        if( Object.IsNull() ) {
+            if( heldCount == 2 ) {
+                const bool typeFirst = held[0].first == "type";
+                JSON leaf = tagged_leaf( held[typeFirst ? 0 : 1].second, held[typeFirst ? 1 : 0].second );
+                if( !leaf.IsNull() )
+                    return leaf;
+            }
+            materialize();
+        }
+        return std::move( Object );
+    }
+
+    JSON parse_array( Context &ctx, size_t &offset ) {
+        const Input &str = ctx.str;
+        JSON Array = JSON::Make( JSON::Class::Array );
+        unsigned index = 0;
+        
+        ++offset;
+        consume_ws( str, offset );
+        if( str[offset] == ']' ) {
+            ++offset; return std::move( Array );
+        }
+
+        while( true ) {
+            Array[index++] = parse_next( ctx, offset );
+            if( failed( ctx ) )
+                return JSON();
+            consume_ws( str, offset );
+
+            if( str[offset] == ',' ) {
+                ++offset; continue;
+            }
+            else if( str[offset] == ']' ) {
+                ++offset; break;
+            }
+            else {
+                if( stop( ctx, offset < str.size() ? ErrorCode::ExpectedCommaOrBracket : ErrorCode::UnexpectedEnd, offset ) )
+                    return JSON();
+                std::cerr << "ERROR: Array: Expected ',' or ']', found '" << str[offset] << "'\n";
+                return std::move( JSON::Make( JSON::Class::Array ) );
+            }
+        }
+
+        return std::move( Array );
+    }
+
+    JSON parse_string( Context &ctx, size_t &offset ) {
+        bool escapes;
+        const size_t start = offset;
+        const string_view body = scan_string( ctx.str, offset, escapes );
+        if( !terminated( ctx.str, body ) && stop( ctx, ErrorCode::UnterminatedString, start ) )
+            return JSON();
+        if( ctx.InPlace )
+            return JSON::StringView( body, escapes );
+        return JSON::EscapedString( body, escapes );
+    }
+
+    inline const char *skip_digits( const char *p, const char *end ) {
+        while( p != end && *p >= '0' && *p <= '9' )
+            ++p;
+        return p;
     }
-}
 
-JSON JSON::Load( const string &str ) {
-    size_t offset = 0;
-    return std::move( parse_next( str, offset ) );
+    // Moves p past the number starting there. False, with p on the
+    // offending character, if the exponent has no digits.
+    inline bool scan_number( const char *&p, const char *end, bool &isDouble ) {
+        isDouble = false;
+        if( p != end && *p == '-' )
+            ++p;
+        p = skip_digits( p, end );
+        if( p != end && *p == '.' ) {
+            isDouble = true;
+            const char *digits = ++p;
+            p = skip_digits( p, end );
+            if( p == digits )
+                return false;
+        }
+        if( p != end && ( *p == 'E' || *p == 'e' ) ) {
+            isDouble = true;
+            if( ++p != end && ( *p == '+' || *p == '-' ) )
+                ++p;
+            const char *digits = p;
+            p = skip_digits( p, end );
+            if( p == digits )
+                return false;
+        }
+        return true;
+    }
+
+    // Whether a number may be followed by the character at p.
+    inline bool ends_number( const char *p, const char *end ) {
+        return p == end || is_ws( *p ) || *p == ',' || *p == ']' || *p == '}';
+    }
+
+    // What a well formed number too big or too small for a double reads as:
+    // +-inf if its leading digit is at 10^0 or above, +-0 if below. Worked
+    // out from the digits, as strtod's result depends on the locale.
+    inline double out_of_range_value( const char *begin, const char *end ) {
+        const bool negative = *begin == '-';
+        const char *p = begin + negative;
+
+        long long magnitude = -1;    // of the leading non-zero digit
+        bool point = false, found = false;
+        for( ; p != end && *p != 'e' && *p != 'E'; ++p ) {
+            if( *p == '.' )
+                point = true;
+            else if( !found && *p == '0' ) {
+                if( point )
+                    --magnitude;
+            }
+            else if( !found ) {
+                found = true;
+                if( !point )
+                    magnitude = 0;
+            }
+            else if( !point )
+                ++magnitude;
+        }
+
+        if( p != end ) {
+            const bool negativeExponent = *++p == '-';
+            if( *p == '+' || *p == '-' )
+                ++p;
+            long long exponent = 0;
+            for( ; p != end && exponent < ( 1ll << 40 ); ++p )
+                exponent = exponent * 10 + ( *p - '0' );
+            magnitude += negativeExponent ? -exponent : exponent;
+        }
+
+        if( magnitude >= 0 )
+            return negative ? -HUGE_VAL : HUGE_VAL;
+        return negative ? -0.0 : 0.0;
+    }
+
+    // The value of a well formed number; integers too big for a long become doubles.
+    JSON number_value( const char *begin, const char *end, bool isDouble ) {
+        if( !isDouble ) {
+            long i;
+            if( std::from_chars( begin, end, i ).ec == std::errc() )
+                return JSON( i );
+        }
+        double d = 0.0;
+        if( std::from_chars( begin, end, d ).ec == std::errc::result_out_of_range )
+            d = out_of_range_value( begin, end );
+        return JSON( d );
+    }
+
+    JSON parse_number( Context &ctx, size_t &offset ) {
+        const Input &str = ctx.str;
+        const char *begin = str.data() + offset, *end = str.data() + str.size();
+        const char *p = begin;
+        bool isDouble;
+
+        if( !scan_number( p, end, isDouble ) ) {
+            if( stop( ctx, ErrorCode::BadNumber, p - str.data() ) )
+                return JSON();
+            std::cerr << "ERROR: Number: Expected a number for exponent, found '" << ( p != end ? *p : '\0' ) << "'\n";
+            return std::move( JSON::Make( JSON::Class::Null ) );
+        }
+        if( !ends_number( p, end ) || ( p - begin ) == ( *begin == '-' ) ) {
+            if( stop( ctx, ErrorCode::BadNumber, p - str.data() ) )
+                return JSON();
+            std::cerr << "ERROR: Number: unexpected character '" << *p << "'\n";
+            return std::move( JSON::Make( JSON::Class::Null ) );
+        }
+        offset += p - begin;
+
+        if( ctx.KeepNumberText )
+            return JSON::NumberView( string_view( begin, p - begin ) );
+        return number_value( begin, p, isDouble );
+    }
+
+    JSON parse_bool( Context &ctx, size_t &offset ) {
+        const Input &str = ctx.str;
+        JSON Bool;
+        if( str.compare( offset, 4, "true" ) == 0 )
+            Bool = true;
+        else if( str.compare( offset, 5, "false" ) == 0 )
+            Bool = false;
+        else {
+            if( stop( ctx, ErrorCode::BadLiteral, offset ) )
+                return JSON();
+            std::cerr << "ERROR: Bool: Expected 'true' or 'false', found '" << str.substr( offset, 5 ) << "'\n";
+            return std::move( JSON::Make( JSON::Class::Null ) );
+        }
+        offset += (Bool.ToBool() ? 4 : 5);
+        return std::move( Bool );
+    }
+
+    JSON parse_null( Context &ctx, size_t &offset ) {
+        const Input &str = ctx.str;
+        JSON Null;
+        if( str.compare( offset, 4, "null" ) != 0 ) {
+            if( stop( ctx, ErrorCode::BadLiteral, offset ) )
+                return JSON();
+            std::cerr << "ERROR: Null: Expected 'null', found '" << str.substr( offset, 4 ) << "'\n";
+            return std::move( JSON::Make( JSON::Class::Null ) );
+        }
+        offset += 4;
+        return std::move( Null );
+    }
+
+    JSON parse_next( Context &ctx, size_t &offset ) {
+        const Input &str = ctx.str;
+        char value;
+        consume_ws( str, offset );
+        value = str[offset];
+        switch( value ) {
+            case '[' : return std::move( parse_array( ctx, offset ) );
+            case '{' : return std::move( parse_object( ctx, offset ) );
+            case '\"': return std::move( parse_string( ctx, offset ) );
+            case 't' :
+            case 'f' : return std::move( parse_bool( ctx, offset ) );
+            case 'n' : return std::move( parse_null( ctx, offset ) );
+            default  : if( ( value <= '9' && value >= '0' ) || value == '-' )
+                           return std::move( parse_number( ctx, offset ) );
+        }
+        if( stop( ctx, offset < str.size() ? ErrorCode::UnexpectedCharacter : ErrorCode::UnexpectedEnd, offset ) )
+            return JSON();
+        std::cerr << "ERROR: Parse: Unknown starting character '" << value << "'\n";
+        return JSON();
+    }
+
+    // The whole input as one value. When stopping at errors, only
+    // whitespace may follow it, and a failed load gives Null.
+    JSON parse_document( Context &ctx ) {
+        size_t offset = 0;
+        JSON root = parse_next( ctx, offset );
+        if( ctx.Error ) {
+            consume_ws( ctx.str, offset );
+            if( offset < ctx.str.size() )
+                stop( ctx, ErrorCode::TrailingCharacters, offset );
+            if( *ctx.Error )
+                return JSON();
+        }
+        return root;
+    }
+}
+
+inline JSON JSON::Load( const string &str ) {
+    Context ctx{ str, false };
+    return parse_document( ctx );
+}
+
+inline JSON JSON::Load( const PaddedString &str ) {
+    Context ctx{ str, false };
+    return parse_document( ctx );
+}
+
+inline LoadResult JSON::TryLoad( const string &str ) {
+    LoadResult result;
+    Context ctx{ str, false, false, &result.Error };
+    result.Value = parse_document( ctx );
+    return result;
+}
+
+inline LoadResult JSON::TryLoad( const PaddedString &str ) {
+    LoadResult result;
+    Context ctx{ str, false, false, &result.Error };
+    result.Value = parse_document( ctx );
+    return result;
+}
+
+namespace {
+    // Smaller documents aren't worth starting threads for.
+    constexpr size_t ParallelThreshold = 1 << 20;
+
+    // Finds where each member or element of the container opening at
+    // str[open] starts, and close, where it ends. Only strings and
+    // nesting are tracked; the pieces are checked when they are parsed.
+    bool scan_members( const Input &str, size_t open, vector<size_t> &starts, size_t &close ) {
+        const char *begin = str.data(), *end = begin + str.size();
+        size_t depth = 0;
+        starts.assign( 1, open + 1 );
+        for( const char *p = begin + open; p < end; ++p ) {
+            switch( *p ) {
+                case '"':
+                    for( ++p;; p += 2 ) {
+                        p = find_quote_or_escape( p, end );
+                        if( end - p < 2 )
+                            return false;   // nothing can close the container
+                        if( *p == '"' )
+                            break;
+                    }
+                    break;
+                case '{':
+                case '[':
+                    ++depth;
+                    break;
+                case '}':
+                case ']':
+                    if( --depth == 0 ) {
+                        close = p - begin;
+                        return true;
+                    }
+                    break;
+                case ',':
+                    if( depth == 1 )
+                        starts.push_back( p + 1 - begin );
+                    break;
+            }
+        }
+        return false;
+    }
+
+    // Parses the members, or elements, from str[begin] up to the ',' or
+    // bracket at str[end]. False at the first error.
+    bool parse_run( Context &ctx, size_t begin, size_t end, bool object,
+                    vector<string> &keys, vector<JSON> &values ) {
+        const Input &str = ctx.str;
+        size_t offset = begin;
+        string fallback;
+        while( true ) {
+            if( object ) {
+                consume_ws( str, offset );
+                if( str[offset] != '\"' )
+                    return false;
+                bool escapes;
+                const string_view key = scan_string( str, offset, escapes );
+                if( !terminated( str, key ) )
+                    return false;
+                keys.emplace_back( escapes ? Unescape( key, fallback ) : key );
+                consume_ws( str, offset );
+                if( str[offset] != ':' )
+                    return false;
+                ++offset;
+            }
+            values.push_back( parse_next( ctx, offset ) );
+            if( failed( ctx ) )
+                return false;
+            consume_ws( str, offset );
+            if( offset == end )
+                return true;
+            if( offset > end || str[offset] != ',' )
+                return false;
+            ++offset;
+        }
+    }
+
+    // Builds root from runs of the root's members parsed on several
+    // threads. False, leaving root alone, when the input has to be
+    // loaded on one thread instead.
+    bool parse_parallel( const string &text, unsigned threads, JSON &root ) {
+        if( threads == 0 )
+            threads = std::thread::hardware_concurrency();
+        const Input str( text );
+        size_t open = 0;
+        consume_ws( str, open );
+        if( threads < 2 || text.size() < ParallelThreshold || ( str[open] != '{' && str[open] != '[' ) )
+            return false;
+
+        vector<size_t> starts;
+        size_t close;
+        if( !scan_members( str, open, starts, close ) )
+            return false;
+        size_t after = close + 1;
+        consume_ws( str, after );
+        // An object of two members might be a Tagged leaf; leave those to Load().
+        if( after != text.size() || starts.size() < 3 )
+            return false;
+
+        // A few runs per thread, so that they even out.
+        struct Run {
+            size_t         First, Last;
+            vector<string> Keys;
+            vector<JSON>   Values;
+            bool           Ok = false;
+        };
+        vector<Run> runs;
+        const size_t target = text.size() / ( threads * 4 ) + 1;
+        for( size_t i = 0; i < starts.size(); ) {
+            size_t j = i + 1;
+            while( j < starts.size() && starts[j] - starts[i] < target )
+                ++j;
+            runs.push_back( Run{ i, j, {}, {} } );
+            i = j;
+        }
+
+        const bool object = str[open] == '{';
+        std::atomic<size_t> next( 0 );
+        const auto work = [&] {
+            for( size_t i; ( i = next++ ) < runs.size(); ) {
+                Run &run = runs[i];
+                ParseError error;
+                Context ctx{ str, false, false, &error };
+                const size_t end = run.Last < starts.size() ? starts[run.Last] - 1 : close;
+                try {
+                    run.Ok = parse_run( ctx, starts[run.First], end, object, run.Keys, run.Values );
+                }
+                catch( ... ) {
+                    run.Ok = false;
+                }
+            }
+        };
+        vector<std::thread> pool;
+        for( unsigned t = 1; t < threads && t < runs.size(); ++t )
+            pool.emplace_back( work );
+        work();
+        for( auto &t : pool )
+            t.join();
+
+        for( const Run &run : runs )
+            if( !run.Ok )
+                return false;
+        root = JSON::Make( object ? JSON::Class::Object : JSON::Class::Array );
+        root.reserve( starts.size() );
+        for( Run &run : runs )
+            for( size_t i = 0; i < run.Values.size(); ++i ) {
+                if( object )
+                    root[run.Keys[i]] = std::move( run.Values[i] );
+                else
+                    root.append( std::move( run.Values[i] ) );
+            }
+        return true;
+    }
+}
+
+inline JSON JSON::LoadParallel( const string &str, unsigned threads ) {
+    JSON root;
+    if( !parse_parallel( str, threads, root ) )
+        return Load( str );
+    return root;
+}
+
+inline LoadResult JSON::TryLoadParallel( const string &str, unsigned threads ) {
+    LoadResult result;
+    if( !parse_parallel( str, threads, result.Value ) )
+        return TryLoad( str );
+    return result;
+}
+
+template <typename Text>
+inline ParseError Document::Parse( const Text &text, bool inPlace, LoadOptions options, bool stopAtErrors ) {
+    Scope scope( *this );
+    ParseError error;
+    Context ctx{ text, inPlace, options.KeepNumberText, stopAtErrors ? &error : nullptr };
+    Tree = parse_document( ctx );
+    return error;
+}
+
+inline JSON &Document::Load( const string &str ) {
+    Reset();
+    Parse( str, false, {}, false );
+    return Tree;
+}
+
+inline JSON &Document::LoadInPlace( string str, LoadOptions options ) {
+    Reset();
+    Source = std::move( str );
+    Parse( Source, true, options, false );
+    return Tree;
+}
+
+inline JSON &Document::LoadInPlace( PaddedString str, LoadOptions options ) {
+    Reset();
+    PaddedSource = std::move( str );
+    Parse( PaddedSource, true, options, false );
+    return Tree;
+}
+
+inline ParseError Document::TryLoad( const string &str ) {
+    Reset();
+    return Parse( str, false, {}, true );
+}
+
+inline ParseError Document::TryLoadInPlace( string str, LoadOptions options ) {
+    Reset();
+    Source = std::move( str );
+    return Parse( Source, true, options, true );
+}
+
+inline ParseError Document::TryLoadInPlace( PaddedString str, LoadOptions options ) {
+    Reset();
+    PaddedSource = std::move( str );
+    return Parse( PaddedSource, true, options, true );
+}
+
+/**
+ *  Hands out a stream in chunks of a fixed size, for Reader.
+ *
+ *  With readAhead a thread reads the next chunk while the caller works
+ *  on the current one, so parsing overlaps with reading. Either way no
+ *  more than two chunks are held. The destructor waits for a read that
+ *  is in progress.
+ */
+class ChunkedInput
+{
+    public:
+        explicit ChunkedInput( std::istream &in, size_t chunkSize = 1 << 16, bool readAhead = true )
+            : Stream( in.rdbuf() ), ChunkSize( std::max<size_t>( chunkSize, 1 ) )
+        {
+            Slots[0].Data.reset( new char[ChunkSize] );
+            if( readAhead ) {
+                Slots[1].Data.reset( new char[ChunkSize] );
+                Worker = std::thread( [this]{ Fill(); } );
+            }
+        }
+
+        ~ChunkedInput() {
+            if( !Worker.joinable() )
+                return;
+            {
+                std::lock_guard<std::mutex> lock( Lock );
+                Stopping = true;
+            }
+            Changed.notify_all();
+            Worker.join();
+        }
+
+        ChunkedInput( const ChunkedInput & ) = delete;
+        ChunkedInput& operator=( const ChunkedInput & ) = delete;
+
+        /// The next chunk; empty once the stream is exhausted. Valid until the next call.
+        string_view Next() {
+            if( Finished )
+                return string_view();
+            if( !Worker.joinable() ) {
+                const size_t n = Read( Slots[0].Data.get() );
+                Finished = n == 0;
+                return string_view( Slots[0].Data.get(), n );
+            }
+
+            std::unique_lock<std::mutex> lock( Lock );
+            if( Holding ) {
+                Slots[Current].Full = false;
+                Current ^= 1;
+                Changed.notify_all();
+            }
+            Changed.wait( lock, [this]{ return Slots[Current].Full; } );
+            Holding = true;
+            Finished = Slots[Current].Size == 0;
+            return string_view( Slots[Current].Data.get(), Slots[Current].Size );
+        }
+
+    private:
+        struct Slot {
+            std::unique_ptr<char[]> Data;
+            size_t Size = 0;
+            bool   Full = false;    // read, and not yet handed back by the caller
+        };
+
+        size_t Read( char *into ) {
+            const std::streamsize n = Stream ? Stream->sgetn( into, std::streamsize( ChunkSize ) ) : 0;
+            return n > 0 ? size_t( n ) : 0;
+        }
+
+        // The read ahead thread: fills whichever slot the caller isn't holding.
+        void Fill() {
+            for( size_t slot = 0; ; slot ^= 1 ) {
+                {
+                    std::unique_lock<std::mutex> lock( Lock );
+                    Changed.wait( lock, [&]{ return Stopping || !Slots[slot].Full; } );
+                    if( Stopping )
+                        return;
+                }
+                const size_t n = Read( Slots[slot].Data.get() );
+                {
+                    std::lock_guard<std::mutex> lock( Lock );
+                    Slots[slot].Size = n;
+                    Slots[slot].Full = true;
+                }
+                Changed.notify_all();
+                if( !n )
+                    return;
+            }
+        }
+
+        std::streambuf         *Stream;
+        size_t                  ChunkSize;
+        Slot                    Slots[2];
+        size_t                  Current = 0;
+        bool                    Holding = false;
+        bool                    Finished = false;
+        bool                    Stopping = false;
+        std::mutex              Lock;
+        std::condition_variable Changed;
+        std::thread             Worker;
+};
+
+/**
+ *  Pull parser: hands out a document one event at a time instead of
+ *  building nodes for it.
+ *
+ *  All the reader keeps is a stack of the containers that are open, so
+ *  its memory grows with nesting depth rather than document size. It is
+ *  an explicit state machine; each Next() picks up exactly where the
+ *  last one stopped.
+ *
+ *  Given a string_view, Text() refers into the input, which must
+ *  outlive the reader. Otherwise the input arrives in chunks: pushed
+ *  with Feed() and Finish(), or pulled from a std::istream. The reader
+ *  then keeps a window of it, from the token being read, or the oldest
+ *  Mark still held if that is earlier, to the end of the last chunk. A
+ *  token cut off by the end of a chunk is read again from its start
+ *  once the next one is in, so Text() is always in one piece. It stays
+ *  valid until the next call to Next() or Feed().
+ */
+class Reader
+{
+    public:
+        enum class Event : uint8_t {
+            BeginObject,
+            EndObject,
+            BeginArray,
+            EndArray,
+            Key,        // Text() is the key, escapes included
+            String,     // Text() is the string, escapes included
+            Number,     // Text() is the number as written
+            Bool,       // Text() is "true" or "false"
+            Null,
+            End,        // the whole document has been read
+            Error,      // see Error()
+            NeedInput   // Feed() the next chunk, or Finish(), then call Next() again
+        };
+
+        /// A position to go back to; see Save().
+        struct Mark {
+            size_t  Offset;
+            size_t  Depth;
+            uint8_t State;
+        };
+
+        explicit Reader( string_view input )
+            : Begin( input.data() ), Pos( input.data() ), End( input.data() + input.size() ) {}
+
+        /// Reads padded input without end of input checks in its scanning loops.
+        explicit Reader( const PaddedString &input )
+            : Reader( string_view( input ) ) { Padded = true; }
+
+        /// Takes its input in chunks, from Feed().
+        Reader()
+            : Begin( Window.data() ), Pos( Begin ), End( Begin ), Padded( true ), Final( false ) {}
+
+        /// Reads in from its own thread, chunkSize bytes at a time; see ChunkedInput.
+        explicit Reader( std::istream &in, size_t chunkSize = 1 << 16, bool readAhead = true )
+            : Reader() { Source.reset( new ChunkedInput( in, chunkSize, readAhead ) ); }
+
+        Event Next();
+
+        /// Adds the next chunk of input, for a Reader().
+        void Feed( string_view chunk );
+
+        /// There is no more input after what has been fed.
+        void Finish() { Final = true; }
+
+        string_view Text() const { return Token; }
+        bool HasEscapes() const { return Escapes; }
+
+        /// Text() with its JSON escapes decoded, see json::Unescape().
+        string_view Unescaped( string &buffer ) const {
+            return Escapes ? Unescape( Token, buffer ) : Token;
+        }
+
+        /// Number of containers open.
+        size_t Depth() const { return Open; }
+
+        /// Reads and drops events until no more than depth containers are open.
+        void SkipTo( size_t depth ) {
+            while( Open > depth ) {
+                const Event e = Next();
+                if( e == Event::Error || e == Event::End || e == Event::NeedInput )
+                    return;
+            }
+        }
+
+        /**
+         *  Remembers where the reader is, so it can read ahead and then
+         *  Restore() to here. A mark stays valid until the reader goes
+         *  past the closing event of the container that was innermost
+         *  when it was taken.
+         *
+         *  Chunked input is kept from the mark on until it is given back
+         *  with Restore() or Release(), latest mark first.
+         */
+        Mark Save() {
+            Pins.push_back( Offset() );
+            return Mark{ Pins.back(), Open, uint8_t( Expect ) };
+        }
+        void Restore( const Mark &mark ) {
+            Pos = Begin + ( mark.Offset - Base );
+            Open = mark.Depth;
+            Expect = State( mark.State );
+            Release( mark );
+        }
+        /// Gives a mark back without going to it.
+        void Release( const Mark & ) {
+            if( !Pins.empty() )
+                Pins.pop_back();
+        }
+
+        /// Byte offset into the input that reading has reached.
+        size_t Offset() const { return Base + size_t( Pos - Begin ); }
+
+        /// Why Next() returned Event::Error.
+        const ParseError &Error() const { return Failure; }
+
+    private:
+        enum class State : uint8_t {
+            Value,          // a value
+            FirstMember,    // a key or '}'
+            FirstElement,   // a value or ']'
+            AfterValue,     // ',' or the end of the container, or of the document
+            Done,
+            Failed
+        };
+
+        Event Step();
+        Event ReadKey();
+        Event ReadValue();
+        Event Close();
+
+        const char *SkipWs( const char *p ) const {
+            return Padded ? skip_ws<true>( p, End ) : skip_ws( p, End );
+        }
+
+        Event Fail( ErrorCode code, const char *at ) {
+            Failure.Code = code;
+            Failure.Offset = Base + size_t( at - Begin );
+            Expect = State::Failed;
+            return Event::Error;
+        }
+
+        // The input so far stops inside a token: wait for more of it,
+        // or fail if there is no more.
+        Event Short( ErrorCode code, const char *at ) {
+            return Final ? Fail( code, at ) : Event::NeedInput;
+        }
+
+        void Push( bool object ) {
+            // Entries above Open are kept, so a Mark can still see the
+            // container it was taken in after that container is closed.
+            if( Open == Scopes.size() )
+                Scopes.push_back( object );
+            else
+                Scopes[Open] = object;
+            ++Open;
+        }
+
+        PaddedString                  Window;   // chunked input kept so far
+        const char                   *Begin;
+        const char                   *Pos;
+        const char                   *End;
+        size_t                        Base = 0; // offset of Begin in the whole input
+        vector<bool>                  Scopes;
+        vector<size_t>                Pins;     // offsets of the marks held
+        size_t                        Open = 0;
+        State                         Expect = State::Value;
+        string_view                   Token;
+        bool                          Escapes = false;
+        bool                          Padded = false;
+        bool                          Final = true;
+        std::unique_ptr<ChunkedInput> Source;
+        ParseError                    Failure;
+};
+
+inline Reader::Event Reader::Next() {
+    while( true ) {
+        Pos = SkipWs( Pos );
+        const char *from = Pos;
+        const State expect = Expect;
+        const Event e = Step();
+        if( e != Event::NeedInput )
+            return e;
+
+        // Back to the start of the token that was cut off; it is read
+        // again in full once there is more input.
+        Pos = from;
+        Expect = expect;
+        if( !Source )
+            return e;
+        const string_view chunk = Source->Next();
+        if( chunk.empty() )
+            Finish();
+        else
+            Feed( chunk );
+    }
+}
+
+inline void Reader::Feed( string_view chunk ) {
+    size_t keep = Offset();
+    if( !Pins.empty() )
+        keep = std::min( keep, Pins.front() );
+    const size_t at = size_t( Pos - Begin ), drop = keep - Base;
+    Window.Erase( drop );
+    Window.Append( chunk );
+    Base = keep;
+    Begin = Window.data();
+    Pos = Begin + ( at - drop );
+    End = Begin + Window.size();
+}
+
+inline Reader::Event Reader::Step() {
+    switch( Expect ) {
+        case State::Value:
+            return ReadValue();
+        case State::FirstMember:
+            if( Pos != End && *Pos == '}' )
+                return Close();
+            return ReadKey();
+        case State::FirstElement:
+            if( Pos != End && *Pos == ']' )
+                return Close();
+            return ReadValue();
+        case State::AfterValue:
+            if( !Open ) {
+                if( Pos != End )
+                    return Fail( ErrorCode::TrailingCharacters, Pos );
+                if( !Final )
+                    return Event::NeedInput;
+                Expect = State::Done;
+                return Event::End;
+            }
+            if( Pos != End && *Pos == ',' ) {
+                Pos = SkipWs( Pos + 1 );
+                return Scopes[Open - 1] ? ReadKey() : ReadValue();
+            }
+            return Close();
+        case State::Done:
+            return Event::End;
+        case State::Failed:
+            break;
+    }
+    return Event::Error;
+}
+
+inline Reader::Event Reader::ReadKey() {
+    if( Pos == End )
+        return Short( ErrorCode::UnexpectedEnd, Pos );
+    if( *Pos != '"' )
+        return Fail( ErrorCode::ExpectedKey, Pos );
+    const Event e = ReadValue();
+    if( e != Event::String )
+        return e;
+    Pos = SkipWs( Pos );
+    if( Pos == End )
+        return Short( ErrorCode::UnexpectedEnd, Pos );
+    if( *Pos != ':' )
+        return Fail( ErrorCode::ExpectedColon, Pos );
+    ++Pos;
+    Expect = State::Value;
+    return Event::Key;
+}
+
+inline Reader::Event Reader::ReadValue() {
+    if( Pos == End )
+        return Short( ErrorCode::UnexpectedEnd, Pos );
+
+    const char *start = Pos;
+    Escapes = false;
+    Expect = State::AfterValue;
+    switch( *Pos ) {
+        case '{':
+            ++Pos;
+            Push( true );
+            Expect = State::FirstMember;
+            return Event::BeginObject;
+        case '[':
+            ++Pos;
+            Push( false );
+            Expect = State::FirstElement;
+            return Event::BeginArray;
+        case '"':
+            ++start;
+            Pos = start;
+            while( true ) {
+                Pos = Padded ? find_quote_or_escape<true>( Pos, End ) : find_quote_or_escape( Pos, End );
+                if( Pos >= End )
+                    return Short( ErrorCode::UnterminatedString, start - 1 );
+                if( *Pos == '"' )
+                    break;
+                if( *Pos == '\\' ) {
+                    Escapes = true;
+                    Pos += ( End - Pos ) > 1 ? 2 : 1;
+                }
+                else
+                    ++Pos;
+            }
+            Token = string_view( start, Pos - start );
+            ++Pos;
+            return Event::String;
+        case 't':
+        case 'f':
+        case 'n': {
+            const string_view rest( Pos, End - Pos );
+            for( const string_view literal : { string_view( "true" ), string_view( "false" ), string_view( "null" ) } ) {
+                if( rest.substr( 0, literal.size() ) == literal ) {
+                    Token = rest.substr( 0, literal.size() );
+                    Pos += literal.size();
+                    return *start == 'n' ? Event::Null : Event::Bool;
+                }
+                if( rest.size() < literal.size() && literal.substr( 0, rest.size() ) == rest )
+                    return Short( ErrorCode::BadLiteral, start );
+            }
+            return Fail( ErrorCode::BadLiteral, start );
+        }
+        default: {
+            if( *Pos != '-' && ( *Pos < '0' || *Pos > '9' ) )
+                return Fail( ErrorCode::UnexpectedCharacter, Pos );
+            const char *digit = *Pos == '-' ? Pos + 1 : Pos;
+            bool isDouble;
+            if( digit == End )
+                return Short( ErrorCode::BadNumber, digit );
+            if( *digit < '0' || *digit > '9' )
+                return Fail( ErrorCode::BadNumber, digit );
+            const bool scanned = scan_number( Pos, End, isDouble );
+            // The number may go on in the next chunk.
+            if( Pos == End && !Final )
+                return Event::NeedInput;
+            if( !scanned || !ends_number( Pos, End ) )
+                return Fail( ErrorCode::BadNumber, Pos );
+            Token = string_view( start, Pos - start );
+            return Event::Number;
+        }
+    }
+}
+
+inline Reader::Event Reader::Close() {
+    const bool object = Scopes[Open - 1];
+    if( Pos == End )
+        return Short( ErrorCode::UnexpectedEnd, Pos );
+    if( *Pos != ( object ? '}' : ']' ) )
+        return Fail( object ? ErrorCode::ExpectedCommaOrBrace : ErrorCode::ExpectedCommaOrBracket, Pos );
+    ++Pos;
+    --Open;
+    Expect = State::AfterValue;
+    return object ? Event::EndObject : Event::EndArray;
+}
+
+namespace {
+    // Builds a tree from the reader's events for the stream loaders.
+    // Open containers are kept on a stack of their own, not the call stack.
+    ParseError build_tree( Reader &reader, JSON &root ) {
+        vector<JSON*> open;
+        JSON *slot = &root;
+        string key;
+        while( true ) {
+            const Reader::Event e = reader.Next();
+            switch( e ) {
+                case Reader::Event::End:
+                    return ParseError();
+                case Reader::Event::Error:
+                case Reader::Event::NeedInput:
+                    root = JSON();
+                    return reader.Error();
+                case Reader::Event::Key:
+                    slot = &( *open.back() )[reader.Unescaped( key )];
+                    continue;
+                case Reader::Event::EndObject:
+                    tag_leaf( *open.back() );
+                    open.pop_back();
+                    continue;
+                case Reader::Event::EndArray:
+                    open.pop_back();
+                    continue;
+                default:
+                    break;
+            }
+
+            if( !open.empty() && open.back()->JSONType() == JSON::Class::Array ) {
+                JSON &array = *open.back();
+                slot = &array[unsigned( array.length() )];
+            }
+            switch( e ) {
+                case Reader::Event::BeginObject:
+                    *slot = JSON::Make( JSON::Class::Object );
+                    open.push_back( slot );
+                    break;
+                case Reader::Event::BeginArray:
+                    *slot = JSON::Make( JSON::Class::Array );
+                    open.push_back( slot );
+                    break;
+                case Reader::Event::String:
+                    *slot = JSON::EscapedString( reader.Text(), reader.HasEscapes() );
+                    break;
+                case Reader::Event::Number: {
+                    const string_view text = reader.Text();
+                    *slot = number_value( text.data(), text.data() + text.size(),
+                                          text.find_first_of( ".eE" ) != string_view::npos );
+                    break;
+                }
+                case Reader::Event::Bool:
+                    *slot = reader.Text()[0] == 't';
+                    break;
+                default:
+                    *slot = JSON();
+                    break;
+            }
+        }
+    }
+}
+
+inline LoadResult JSON::TryLoad( std::istream &in, size_t chunkSize ) {
+    LoadResult result;
+    Reader reader( in, chunkSize );
+    result.Error = build_tree( reader, result.Value );
+    return result;
+}
+
+inline ParseError Document::TryLoad( std::istream &in, size_t chunkSize ) {
+    Reset();
+    Scope scope( *this );
+    Reader reader( in, chunkSize );
+    return build_tree( reader, Tree );
+}
+
+/**
+ *  A parsed document that can only be read.
+ *
+ *  The whole document is kept in two flat arrays: the tape, one entry
+ *  per key and value in document order, and one buffer with the text of
+ *  every key and string, unescaped. A container's entry says where it
+ *  ends, so skipping over one is a single step, and walking a document
+ *  reads both arrays from front to back. Load() reuses their memory, so
+ *  a warmed up Tape loads without allocating.
+ *
+ *  Values are small handles into the tape, read with the same const
+ *  functions as json::JSON. Objects of just a "type" and a "value"
+ *  string are Tagged, as Load() makes them. Values must not outlive
+ *  the Tape, or be used after the next Load().
+ */
+class Tape
+{
+    public:
+        class Value;
+
+        /// Parses text, replacing the document. Root() is Null after a failure.
+        ParseError Load( string_view text );
+
+        /// Load() from a stream, chunkSize bytes at a time; see Reader.
+        ParseError Load( std::istream &in, size_t chunkSize = 1 << 16 );
+
+        Value Root() const;
+
+    private:
+        struct Entry {
+            JSON::Class Type;
+            uint32_t    Size;       // text length, or number of members or elements
+            union {
+                size_t  Offset;     // of the text in Text
+                size_t  Next;       // index of the first entry after the container
+                double  Float;
+                long    Int;
+                bool    Bool;
+            };
+        };
+
+        ParseError Build( Reader &reader );
+
+        // Index of the entry after the value at i.
+        size_t Skip( size_t i ) const {
+            const Entry &e = Entries[i];
+            return e.Type == JSON::Class::Object || e.Type == JSON::Class::Array ||
+                   e.Type == JSON::Class::Tagged ? e.Next : i + 1;
+        }
+
+        string_view TextOf( size_t i ) const {
+            return string_view( Text.data() + Entries[i].Offset, Entries[i].Size );
+        }
+
+        vector<Entry>  Entries;
+        string         Text;
+        vector<size_t> Open;        // containers being built
+        string         Scratch;     // for unescaping
+};
+
+class Tape::Value
+{
+    public:
+        /// Members as ( key, value ) pairs, and elements, in document order.
+        class MemberIterator;
+        class ElementIterator;
+
+        template <typename Iterator>
+        class Range {
+            Iterator First, Last;
+
+            public:
+                Range( Iterator first, Iterator last ) : First( first ), Last( last ) {}
+                Iterator begin() const { return First; }
+                Iterator end() const { return Last; }
+        };
+
+        Value() : Doc( nullptr ), Index( 0 ) {}
+
+        JSON::Class JSONType() const { return Doc ? At().Type : JSON::Class::Null; }
+        bool IsNull() const { return JSONType() == JSON::Class::Null; }
+
+        /// Members of an Object, 2 for a Tagged, elements of an Array, otherwise -1.
+        int size() const {
+            const JSON::Class type = JSONType();
+            return type == JSON::Class::Object || type == JSON::Class::Array ||
+                   type == JSON::Class::Tagged ? int( At().Size ) : -1;
+        }
+
+        int length() const { return JSONType() == JSON::Class::Array ? int( At().Size ) : -1; }
+
+        bool hasKey( string_view key ) const { return Find( key ) != 0; }
+
+        /// Throws std::out_of_range for missing keys or indices.
+        Value at( string_view key ) const {
+            const size_t i = Find( key );
+            if( !i )
+                throw std::out_of_range( "json::Tape::Value::at: no such key" );
+            return Value( Doc, i );
+        }
+
+        Value at( unsigned index ) const {
+            if( JSONType() != JSON::Class::Array || index >= At().Size )
+                throw std::out_of_range( "json::Tape::Value::at: no such index" );
+            size_t i = Index + 1;
+            while( index-- )
+                i = Doc->Skip( i );
+            return Value( Doc, i );
+        }
+
+        /// Strings are kept unescaped; Unescaped() is the same as ToStringView().
+        string_view ToStringView() const {
+            return JSONType() == JSON::Class::String ? Doc->TextOf( Index ) : string_view();
+        }
+        string_view Unescaped( string & ) const { return ToStringView(); }
+
+        double ToFloat() const { return JSONType() == JSON::Class::Floating ? At().Float : 0.0; }
+        long ToInt() const { return JSONType() == JSON::Class::Integral ? At().Int : 0; }
+        bool ToBool() const { return JSONType() == JSON::Class::Boolean && At().Bool; }
+
+        /// The strings of a Tagged, otherwise empty.
+        string_view TagType() const {
+            return JSONType() == JSON::Class::Tagged ? Value( Doc, Find( "type" ) ).ToStringView() : string_view();
+        }
+        string_view TagValue() const {
+            return JSONType() == JSON::Class::Tagged ? Value( Doc, Find( "value" ) ).ToStringView() : string_view();
+        }
+
+        /// Empty unless this is an Object or an Array.
+        Range<MemberIterator> ObjectRange() const;
+        Range<ElementIterator> ArrayRange() const;
+
+    private:
+        friend class Tape;
+
+        Value( const Tape *doc, size_t index ) : Doc( doc ), Index( index ) {}
+
+        const Entry &At() const { return Doc->Entries[Index]; }
+
+        // Index of the value for key, or 0; the root is never a member.
+        size_t Find( string_view key ) const {
+            const JSON::Class type = JSONType();
+            if( type != JSON::Class::Object && type != JSON::Class::Tagged )
+                return 0;
+            for( size_t i = Index + 1, end = At().Next; i != end; i = Doc->Skip( i + 1 ) )
+                if( Doc->TextOf( i ) == key )
+                    return i + 1;
+            return 0;
+        }
+
+        const Tape *Doc;
+        size_t      Index;
+};
+
+class Tape::Value::MemberIterator
+{
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type        = std::pair<string_view, Value>;
+        using difference_type   = std::ptrdiff_t;
+        using pointer           = void;
+        using reference         = value_type;
+
+        MemberIterator() : Doc( nullptr ), Index( 0 ) {}
+        MemberIterator( const Tape *doc, size_t index ) : Doc( doc ), Index( index ) {}
+
+        value_type operator*() const { return value_type( Doc->TextOf( Index ), Value( Doc, Index + 1 ) ); }
+        MemberIterator &operator++() { Index = Doc->Skip( Index + 1 ); return *this; }
+        MemberIterator operator++( int ) { MemberIterator old = *this; ++*this; return old; }
+        bool operator==( const MemberIterator &other ) const { return Index == other.Index; }
+        bool operator!=( const MemberIterator &other ) const { return Index != other.Index; }
+
+    private:
+        const Tape *Doc;
+        size_t      Index;
+};
+
+class Tape::Value::ElementIterator
+{
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type        = Value;
+        using difference_type   = std::ptrdiff_t;
+        using pointer           = void;
+        using reference         = Value;
+
+        ElementIterator() : Doc( nullptr ), Index( 0 ) {}
+        ElementIterator( const Tape *doc, size_t index ) : Doc( doc ), Index( index ) {}
+
+        Value operator*() const { return Value( Doc, Index ); }
+        ElementIterator &operator++() { Index = Doc->Skip( Index ); return *this; }
+        ElementIterator operator++( int ) { ElementIterator old = *this; ++*this; return old; }
+        bool operator==( const ElementIterator &other ) const { return Index == other.Index; }
+        bool operator!=( const ElementIterator &other ) const { return Index != other.Index; }
+
+    private:
+        const Tape *Doc;
+        size_t      Index;
+};
+
+inline Tape::Value::Range<Tape::Value::MemberIterator> Tape::Value::ObjectRange() const {
+    if( JSONType() != JSON::Class::Object )
+        return Range<MemberIterator>( MemberIterator(), MemberIterator() );
+    return Range<MemberIterator>( MemberIterator( Doc, Index + 1 ), MemberIterator( Doc, At().Next ) );
+}
+
+inline Tape::Value::Range<Tape::Value::ElementIterator> Tape::Value::ArrayRange() const {
+    if( JSONType() != JSON::Class::Array )
+        return Range<ElementIterator>( ElementIterator(), ElementIterator() );
+    return Range<ElementIterator>( ElementIterator( Doc, Index + 1 ), ElementIterator( Doc, At().Next ) );
+}
+
+inline Tape::Value Tape::Root() const {
+    return Entries.empty() ? Value() : Value( this, 0 );
+}
+
+inline ParseError Tape::Load( string_view text ) {
+    Reader reader( text );
+    return Build( reader );
+}
+
+inline ParseError Tape::Load( std::istream &in, size_t chunkSize ) {
+    Reader reader( in, chunkSize );
+    return Build( reader );
+}
+
+inline ParseError Tape::Build( Reader &reader ) {
+    Entries.clear();
+    Text.clear();
+    Open.clear();
+    while( true ) {
+        const Reader::Event e = reader.Next();
+        Entry entry;
+        entry.Size = 0;
+        entry.Int = 0;
+        switch( e ) {
+            case Reader::Event::End:
+                return ParseError();
+            case Reader::Event::Error:
+            case Reader::Event::NeedInput:
+                Entries.clear();
+                return reader.Error();
+            case Reader::Event::EndObject:
+            case Reader::Event::EndArray: {
+                Entry &open = Entries[Open.back()];
+                open.Next = Entries.size();
+                // A toml-test leaf: "type" and "value" keys, each with a string.
+                if( e == Reader::Event::EndObject && open.Size == 2 ) {
+                    const size_t i = Open.back();
+                    const string_view first = TextOf( i + 1 ), second = TextOf( i + 3 );
+                    if( Entries[i + 2].Type == JSON::Class::String && Entries[i + 4].Type == JSON::Class::String &&
+                        ( ( first == "type" && second == "value" ) || ( first == "value" && second == "type" ) ) )
+                        open.Type = JSON::Class::Tagged;
+                }
+                Open.pop_back();
+                continue;
+            }
+            case Reader::Event::Key:
+            case Reader::Event::String: {
+                const string_view text = reader.Unescaped( Scratch );
+                entry.Type = JSON::Class::String;
+                entry.Size = uint32_t( text.size() );
+                entry.Offset = Text.size();
+                Text.append( text );
+                break;
+            }
+            case Reader::Event::BeginObject:
+            case Reader::Event::BeginArray:
+                entry.Type = e == Reader::Event::BeginObject ? JSON::Class::Object : JSON::Class::Array;
+                break;
+            case Reader::Event::Number: {
+                const string_view text = reader.Text();
+                const JSON n = number_value( text.data(), text.data() + text.size(),
+                                             text.find_first_of( ".eE" ) != string_view::npos );
+                entry.Type = n.JSONType();
+                if( entry.Type == JSON::Class::Integral )
+                    entry.Int = n.ToInt();
+                else
+                    entry.Float = n.ToFloat();
+                break;
+            }
+            case Reader::Event::Bool:
+                entry.Type = JSON::Class::Boolean;
+                entry.Bool = reader.Text()[0] == 't';
+                break;
+            default:
+                entry.Type = JSON::Class::Null;
+                break;
+        }
+
+        // Keys aren't counted; their values are.
+        if( !Open.empty() && e != Reader::Event::Key )
+            ++Entries[Open.back()].Size;
+        if( e == Reader::Event::BeginObject || e == Reader::Event::BeginArray )
+            Open.push_back( Entries.size() );
+        Entries.push_back( entry );
+    }
 }
 
 } // End Namespace json
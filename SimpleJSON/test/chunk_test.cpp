@@ -0,0 +1,62 @@
+#include "json.hpp"
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+using namespace std;
+using json::JSON;
+
+/**
+ *  Loads each input file given, and every truncation of it, from a
+ *  stream in chunks of 1 byte up to one past its size, and checks that
+ *  each load gives the tree, or the error and offset, that loading the
+ *  whole text with JSON::TryLoad( string ) does.
+ */
+
+static int failures = 0;
+
+static string describe( const json::LoadResult &result ) {
+    if( result.Ok() )
+        return result.Value.dump();
+    return string( result.Error.Message() ) + " at byte " + to_string( result.Error.Offset );
+}
+
+static void check( const string &name, const string &text ) {
+    const string expected = describe( JSON::TryLoad( text ) );
+    for( size_t chunk = 1; chunk <= text.size() + 1; ++chunk ) {
+        istringstream in( text );
+        const string actual = describe( JSON::TryLoad( in, chunk ) );
+        if( actual != expected ) {
+            cerr << name << ", " << text.size() << " bytes, in chunks of " << chunk << ":\n"
+                 << "Expected: " << expected << "\n"
+                 << "Actual:   " << actual << endl;
+            ++failures;
+        }
+    }
+}
+
+int main( int argc, char **argv )
+{
+    if( argc < 2 ) {
+        cout << "Usage: " << argv[0] << " input.json...\n";
+        return 1;
+    }
+
+    for( int i = 1; i < argc; ++i ) {
+        ifstream file( argv[i], ios::binary );
+        if( !file ) {
+            cerr << argv[i] << ": cannot open" << endl;
+            return 1;
+        }
+        const string text{ istreambuf_iterator<char>( file ), istreambuf_iterator<char>() };
+
+        for( size_t length = 0; length <= text.size(); ++length )
+            check( argv[i], text.substr( 0, length ) );
+    }
+
+    if( failures ) {
+        cerr << failures << " loads differed" << endl;
+        return 1;
+    }
+    return 0;
+}
@@ -24,3 +24,55 @@ for x in inputs:
             print x,'passed.'
     except:
         print 'Error: Failed', x, '- Subprocess failed'
+
+# Malformed input: tester must fail, saying why and where as
+# ( message, byte offset, line, column ).
+invalid = {
+    'bad_exponent.json':              ( "Malformed number", 7, 1, 8 ),
+    'bad_fraction.json':              ( "Malformed number", 6, 1, 7 ),
+    'bad_literal.json':               ( "Expected 'true', 'false' or 'null'", 7, 1, 8 ),
+    'bad_number.json':                ( "Malformed number", 5, 1, 6 ),
+    'empty.json':                     ( "Unexpected end of input", 0, 1, 1 ),
+    'expected_colon.json':            ( "Expected ':' after a key", 18, 3, 7 ),
+    'expected_comma_or_brace.json':   ( "Expected ',' or '}'", 8, 1, 9 ),
+    'expected_comma_or_bracket.json': ( "Expected ',' or ']'", 3, 1, 4 ),
+    'expected_key.json':              ( "Expected a key", 9, 1, 10 ),
+    'trailing_characters.json':       ( "Unexpected characters after the document", 6, 3, 3 ),
+    'unexpected_character.json':      ( "Unexpected character", 4, 1, 5 ),
+    'unexpected_end.json':            ( "Unexpected end of input", 11, 1, 12 ),
+    'unterminated_string.json':       ( "Unterminated string", 6, 1, 7 ),
+}
+
+for name in sorted( invalid ):
+    x = './invalid/' + name
+    p = Popen(['./bin/tester', x], stdout=PIPE, stderr=PIPE)
+    _, error = p.communicate()
+
+    expected = '%s: %s at byte %d, line %d, column %d' % ( ( x, ) + invalid[name] )
+    if p.returncode == 0:
+        print 'Error: Failed', x, '- loaded malformed input'
+    elif error.strip() != expected:
+        print 'Error: Failed', x
+        print 'Expected:', expected
+        print 'Actual:', error.strip()
+    else:
+        print x,'passed.'
+
+# Every case and every truncation of it, loaded from a stream in chunks
+# of each size, must give what loading it whole does.
+p = Popen(['./bin/chunk_test'] + inputs + sorted( [ './invalid/' + f for f in invalid ] ), stdout=PIPE, stderr=PIPE)
+_, error = p.communicate()
+if p.returncode != 0:
+    print 'Error: Failed chunked loads'
+    print error
+else:
+    print 'Chunked loads passed.'
+
+# Objects that load as Tagged nodes must still read as objects.
+p = Popen(['./bin/tagged_test'], stdout=PIPE, stderr=PIPE)
+_, error = p.communicate()
+if p.returncode != 0:
+    print 'Error: Failed tagged members'
+    print error
+else:
+    print 'Tagged members passed.'
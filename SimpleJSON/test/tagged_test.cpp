@@ -0,0 +1,68 @@
+#include "json.hpp"
+#include <iostream>
+#include <sstream>
+
+using namespace std;
+using json::JSON;
+
+/**
+ *  Objects of just a "type" and a "value" string load as Tagged nodes.
+ *  Read through the generic API, they must still look like the objects
+ *  they were written as, however they were loaded.
+ */
+
+static int failures = 0;
+
+static void expect( bool ok, const string &how, const char *what ) {
+    if( !ok ) {
+        cerr << how << ": " << what << endl;
+        ++failures;
+    }
+}
+
+static void check( const JSON &leaf, const string &how ) {
+    expect( leaf.hasKey( "type" ) && leaf.hasKey( "value" ) && !leaf.hasKey( "other" ), how, "hasKey" );
+    expect( leaf.size() == 2, how, "size" );
+
+    try {
+        expect( leaf.at( "type" ).ToStringView() == "x", how, "at( \"type\" )" );
+        expect( leaf.at( "value" ).ToStringView() == "y \"z\"", how, "at( \"value\" )" );
+        expect( leaf.at( "type" ).JSONType() == JSON::Class::String, how, "member type" );
+    }
+    catch( const exception &e ) {
+        expect( false, how, e.what() );
+    }
+
+    bool missing = false;
+    try {
+        leaf.at( "other" );
+    }
+    catch( const out_of_range & ) {
+        missing = true;
+    }
+    expect( missing, how, "at( \"other\" ) throws out_of_range" );
+}
+
+int main()
+{
+    const string text = R"({"type":"x","value":"y \"z\""})";
+
+    check( JSON::Load( text ), "Load" );
+    check( JSON::TryLoad( text ).Value, "TryLoad" );
+
+    istringstream in( text );
+    check( JSON::TryLoad( in, 4 ).Value, "TryLoad( istream )" );
+
+    json::Document doc;
+    doc.TryLoad( "[" + text + "]" );
+    check( static_cast<const JSON &>( doc.Root() ).at( 0u ), "Document" );
+
+    const JSON copy = JSON::Load( text );
+    check( JSON( copy ), "copy" );
+
+    if( failures ) {
+        cerr << failures << " failed" << endl;
+        return 1;
+    }
+    return 0;
+}
@@ -1,7 +1,5 @@
 #include "json.hpp"
 #include <iostream>
-#include <fstream>
-#include <streambuf>
 
 using namespace std;
 using json::JSON;
@@ -22,16 +20,24 @@ int main( int argc, char **argv )
     if( argc != 2 )
         usage( argv[0] );
 
-    string contents;
-    ifstream input( argv[1] );
-    input.seekg( 0, ios::end );
-    contents.reserve( input.tellg() );
-    input.seekg( 0, ios::beg );
+    json::PaddedString input;
+    try {
+        input = json::PaddedString::ReadFile( argv[1] );
+    }
+    catch( const system_error &e ) {
+        cerr << e.what() << endl;
+        return 1;
+    }
 
-    contents.assign( (istreambuf_iterator<char>( input )),
-                     istreambuf_iterator<char>() );
+    json::LoadResult result = JSON::TryLoad( input );
+    if( !result.Ok() ) {
+        const json::ParseError::Position at = result.Error.Locate( input );
+        cerr << argv[1] << ": " << result.Error.Message() << " at byte " << result.Error.Offset
+             << ", line " << at.Line << ", column " << at.Column << endl;
+        return 1;
+    }
 
-    JSON obj = JSON::Load( contents );
+    JSON &obj = result.Value;
 
     //ofstream output( argv[2] );
     cout << obj << endl;
@@ -0,0 +1,151 @@
+#ifndef TOML_TEST_BENCH_HPP
+#define TOML_TEST_BENCH_HPP
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <initializer_list>
+#include <new>
+#include <string_view>
+#include <vector>
+
+// What the benchmarks in bench/ share: their command line, timing with
+// warm-up runs and repeats, heap allocations counted by replacing
+// operator new, and printing results as a table or as csv.
+//
+// Each benchmark is one source file, and includes this once; the
+// replacement operator new and delete can't be defined anywhere else.
+
+namespace bench
+{
+	using namespace std::string_view_literals;
+
+	// operator new calls so far
+	inline auto allocations = std::size_t{};
+
+	inline void* counted_new(const std::size_t n)
+	{
+		++allocations;
+		if (auto p = std::malloc(n ? n : 1))
+			return p;
+		throw std::bad_alloc{};
+	}
+
+	struct options
+	{
+		std::vector<unsigned long> sizes;	// the numbers given, or the defaults
+		int warmup = 1;		// untimed runs first
+		int repeat = 5;		// timed runs, the fastest of which counts
+		bool csv = false;
+	};
+
+	// [size...] [--warmup n] [--repeat n] [--csv]; what the sizes mean is up
+	// to the benchmark, and any not given are taken from defaults
+	inline options parse_options(const int argc, char** argv, const std::initializer_list<unsigned long> defaults)
+	{
+		auto o = options{};
+		for (auto i = 1; i < argc; ++i)
+		{
+			const auto arg = std::string_view{ argv[i] };
+			if (arg == "--csv"sv)
+				o.csv = true;
+			else if (arg == "--warmup"sv && i + 1 < argc)
+				o.warmup = std::max(0, std::atoi(argv[++i]));
+			else if (arg == "--repeat"sv && i + 1 < argc)
+				o.repeat = std::max(1, std::atoi(argv[++i]));
+			else
+				o.sizes.push_back(std::strtoul(argv[i], nullptr, 10));
+		}
+
+		for (auto d = begin(defaults) + std::min(size(o.sizes), size(defaults)); d != end(defaults); ++d)
+			o.sizes.push_back(*d);
+		return o;
+	}
+
+	// per operation, from the fastest of the timed runs
+	struct result
+	{
+		double ns, allocations;
+	};
+
+	// calls f(i) for each i below n, once per run; f's results are summed,
+	// which keeps the work from being optimised away
+	template<typename F>
+	result measure(const options& o, const std::size_t n, F f)
+	{
+		auto total = std::size_t{};
+		for (auto r = 0; r < o.warmup; ++r)
+		{
+			for (auto i = std::size_t{}; i < n; ++i)
+				total += static_cast<std::size_t>(f(i));
+		}
+
+		auto best = 1e30;
+		auto allocated = std::size_t{};
+		for (auto r = 0; r < o.repeat; ++r)
+		{
+			const auto before = allocations;
+			const auto start = std::chrono::steady_clock::now();
+			for (auto i = std::size_t{}; i < n; ++i)
+				total += static_cast<std::size_t>(f(i));
+			const auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			if (seconds < best)
+			{
+				best = seconds;
+				allocated = allocations - before;
+			}
+		}
+
+		if (total == 0)
+			std::printf("no output\n");
+		const auto count = static_cast<double>(std::max(n, std::size_t{ 1 }));
+		return { best * 1e9 / count, static_cast<double>(allocated) / count };
+	}
+
+	// the first line of output: what the rows are, then a name for each of
+	// their results
+	inline void print_header(const options& o, const std::string_view rows,
+		const std::initializer_list<std::string_view> columns)
+	{
+		if (o.csv)
+		{
+			std::printf("%.*s", static_cast<int>(size(rows)), data(rows));
+			for (const auto c : columns)
+				std::printf(",%.*s_ns,%.*s_allocs", static_cast<int>(size(c)), data(c), static_cast<int>(size(c)), data(c));
+		}
+		else
+		{
+			std::printf("%-24.*s", static_cast<int>(size(rows)), data(rows));
+			for (const auto c : columns)
+				std::printf(" %12.*s %10s", static_cast<int>(size(c)), data(c), "allocs");
+		}
+		std::printf("\n");
+	}
+
+	inline void print_row(const options& o, const std::string_view name, const std::initializer_list<result> results)
+	{
+		if (o.csv)
+		{
+			std::printf("%.*s", static_cast<int>(size(name)), data(name));
+			for (const auto& r : results)
+				std::printf(",%.1f,%.2f", r.ns, r.allocations);
+		}
+		else
+		{
+			std::printf("%-24.*s", static_cast<int>(size(name)), data(name));
+			for (const auto& r : results)
+				std::printf(" %9.1f ns %10.2f", r.ns, r.allocations);
+		}
+		std::printf("\n");
+	}
+}
+
+void* operator new(std::size_t n) { return bench::counted_new(n); }
+void* operator new[](std::size_t n) { return bench::counted_new(n); }
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+
+#endif
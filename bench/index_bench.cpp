@@ -0,0 +1,101 @@
+#include <algorithm>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "bench.hpp"
+#include "toml_index.hpp"
+
+// Key lookup benchmark.
+//
+// Parses a configuration-like document of services, each a table with a
+// few values and a nested table of limits, one with a quoted dotted key,
+// then looks up every value in a shuffled order and reports ns and heap
+// allocations per lookup: with chained operator[] as read_toml in
+// decoder.cpp does, and with a toml_index by string_view path and by
+// precomputed key. Building the index is timed too, per build.
+//
+// Usage: toml-test-index-bench [services] [--warmup n] [--repeat n] [--csv]
+
+namespace
+{
+	// one value in the document: the keys to it, one per level, and its
+	// path for toml_index
+	struct lookup
+	{
+		std::vector<std::string> keys;
+		std::string path;
+	};
+}
+
+int main(int argc, char** argv)
+{
+	const auto options = bench::parse_options(argc, argv, { 1000ul });
+	const auto services = options.sizes[0];
+
+	auto text = std::string{};
+	auto lookups = std::vector<lookup>{};
+	for (auto i = 0ul; i < services; ++i)
+	{
+		const auto name = "service_" + std::to_string(i);
+		text += "[" + name + "]\n";
+		text += "host = \"host" + std::to_string(i) + ".example.com\"\n";
+		text += "port = " + std::to_string(8000 + i) + "\n";
+		text += "enabled = true\n";
+		text += "[" + name + ".limits]\n";
+		text += "\"max.connections\" = 100\n";
+		text += "timeout = 30.5\n";
+
+		for (const auto key : { "host", "port", "enabled" })
+			lookups.push_back({ { name, key }, name + "." + key });
+		lookups.push_back({ { name, "limits", "max.connections" }, name + ".limits.\"max.connections\"" });
+		lookups.push_back({ { name, "limits", "timeout" }, name + ".limits.timeout" });
+	}
+
+	std::shuffle(begin(lookups), end(lookups), std::mt19937{ 42 });
+
+	const auto root = toml::parse(std::string_view{ text });
+
+	const auto build = bench::measure(options, 1, [&](std::size_t) {
+		return toml_index{ root }.size();
+	});
+
+	const auto index = toml_index{ root };
+	auto keys = std::vector<toml_index::key>{};
+	for (const auto& l : lookups)
+		keys.push_back(toml_index::make_key(l.path));
+
+	const auto chain = [&](const lookup& l) {
+		auto n = root[l.keys[0]][l.keys[1]];
+		if (size(l.keys) > 2)
+			n = n[l.keys[2]];
+		return n;
+	};
+
+	// checks the lookups before timing them
+	for (const auto& l : lookups)
+	{
+		const auto found = index.find(l.path);
+		if (!found || found->as_string() != chain(l).as_string())
+			std::printf("index differs from operator[] at %s\n", l.path.c_str());
+	}
+
+	const auto chained = bench::measure(options, size(lookups), [&](const std::size_t i) {
+		return chain(lookups[i]).good();
+	});
+
+	const auto by_path = bench::measure(options, size(lookups), [&](const std::size_t i) {
+		return index.find(lookups[i].path) != nullptr;
+	});
+
+	const auto by_key = bench::measure(options, size(lookups), [&](const std::size_t i) {
+		return index.find(keys[i]) != nullptr;
+	});
+
+	bench::print_header(options, "operation", { "time" });
+	bench::print_row(options, "toml_index build", { build });
+	bench::print_row(options, "chained operator[]", { chained });
+	bench::print_row(options, "toml_index, path", { by_path });
+	bench::print_row(options, "toml_index, key", { by_key });
+}
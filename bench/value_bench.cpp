@@ -0,0 +1,76 @@
+#include <string>
+#include <vector>
+
+#include "bench.hpp"
+#include "toml_value.hpp"
+
+// Scalar formatting benchmark.
+//
+// Parses a document of leaves of one type at a time, and reports ns and
+// heap allocations per leaf for the "value" text the decoder writes:
+// from as_string, as the decoder used to make it, and from value_text.
+//
+// Usage: toml-test-value-bench [leaves] [--warmup n] [--repeat n] [--csv]
+
+namespace
+{
+	struct leaf_type
+	{
+		const char* name;
+		const char* toml;	// a value of this type
+	};
+
+	constexpr leaf_type leaf_types[] = {
+		{ "integer", "-1234567890123456789" },
+		{ "float", "6.02214076e23" },
+		{ "bool", "true" },
+		{ "string", "\"a short one\"" },
+		{ "long string", "\"rather longer than the small string buffer\"" },
+		{ "datetime", "1979-05-27T07:32:00-08:00" },
+		{ "datetime-local", "1979-05-27T07:32:00" },
+		{ "date-local", "1979-05-27" },
+		{ "time-local", "07:32:00.999999" },
+	};
+
+	// as the decoder made the value text before value_text
+	std::string old_value_text(const toml::node& n)
+	{
+		if (n.type() == toml::value_type::integer)
+			return n.as_string(toml::int_base::dec);
+		else if (n.type() == toml::value_type::floating_point)
+			return n.as_string(toml::float_rep::default, 19);
+		else
+			return n.as_string();
+	}
+}
+
+int main(int argc, char** argv)
+{
+	const auto options = bench::parse_options(argc, argv, { 100000ul });
+	const auto count = options.sizes[0];
+
+	bench::print_header(options, "type", { "as_string", "value_text" });
+
+	for (const auto& type : leaf_types)
+	{
+		auto text = std::string{};
+		for (auto i = 0ul; i < count; ++i)
+			text += "k" + std::to_string(i) + " = " + type.toml + '\n';
+
+		const auto root = toml::parse(std::string_view{ text });
+		auto leaves = std::vector<toml::node>{};
+		for (const auto& key : root)
+			leaves.push_back(key.get_first_child());
+
+		const auto old = bench::measure(options, size(leaves), [&](const std::size_t i) {
+			return size(old_value_text(leaves[i]));
+		});
+
+		auto buffer = std::string{};
+		const auto now = bench::measure(options, size(leaves), [&](const std::size_t i) {
+			return size(value_text(leaves[i], buffer));
+		});
+
+		bench::print_row(options, type.name, { old, now });
+	}
+}
@@ -1,16 +1,30 @@
-﻿#include <array>
+﻿#include <algorithm>
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <filesystem>
+#include <fstream>
 #include <iostream>
+#include <map>
+#include <mutex>
+#include <numeric>
+#include <sstream>
 #include <string_view>
+#include <thread>
+#include <vector>
 
 #include "json.hpp"
+#include "serve.hpp"
+#include "stats.hpp"
+#include "toml_to_json.hpp"
 
 #include "another_toml/parser.hpp"
-#include "another_toml/string_util.hpp"
 
 using namespace std::string_view_literals;
 namespace toml = another_toml;
 
-void stream_to_json(std::ostream&, const toml::root_node&);
+int decode_files(const std::vector<std::string_view>&, const std::filesystem::path&, unsigned, const decode_options&);
+int decode_stats(std::string_view, const decode_options&, unsigned);
 
 constexpr auto str = u8"""\r"""sv;
 
@@ -24,13 +38,88 @@ void read_toml(const toml::root_node& r)
 
 int main(int argc, char** args)
 {
+	// --dom: build the whole document as a json::JSON tree and print that,
+	//		rather than writing json text while the toml is walked.
+	// --check: write it both ways and fail if the two differ.
+	// --server: decode framed documents from stdin until it ends, see serve.hpp;
+	//		can be given with --dom or --check.
+	// [file]: read the toml from a file rather than stdin; either way it is
+	//		read whole, with json::PaddedString, before it is parsed.
+	// [file or directory...]: decode several files, or every .toml file under a
+	//		directory, on a thread each, see decode_files.
+	// --out <directory>: write each file's json under directory.
+	// --jobs <n>: decode on n threads rather than one per core.
+	// --max-depth <n>: fail documents with tables and arrays nested more
+	//		than n deep, counting the root table; see default_max_depth.
+	// --stats: time each stage of decoding one document, and write the
+	//		times as json to stderr, see stats.hpp; an error with --out or
+	//		several files.
+	// --repeat <n>: with --stats, decode it n times.
+	auto options = decode_options{};
+	auto server = false, stats = false, repeated = false;
+	auto repeat = 1u;
+	auto paths = std::vector<std::string_view>{};
+	auto out_dir = std::filesystem::path{};
+	auto jobs = 0u;
+	for (auto i = 1; i < argc; ++i)
+	{
+		const auto arg = std::string_view{ args[i] };
+		options.use_dom |= arg == "--dom"sv;
+		options.check |= arg == "--check"sv;
+		server |= arg == "--server"sv;
+		stats |= arg == "--stats"sv;
+		if (arg == "--out"sv && i + 1 < argc)
+			out_dir = args[++i];
+		else if (arg == "--jobs"sv && i + 1 < argc)
+			jobs = static_cast<unsigned>(std::strtoul(args[++i], nullptr, 10));
+		else if (arg == "--max-depth"sv && i + 1 < argc)
+			options.max_depth = std::strtoull(args[++i], nullptr, 10);
+		else if (arg == "--repeat"sv && i + 1 < argc)
+		{
+			repeat = std::max(1u, static_cast<unsigned>(std::strtoul(args[++i], nullptr, 10)));
+			repeated = true;
+		}
+		else if (arg.substr(0, 2) != "--"sv)
+			paths.push_back(arg);
+	}
+
+	if (server)
+	{
+		std::ios_base::sync_with_stdio(false);
+		return serve(std::cin, std::cout, [&](const std::string& document, std::ostream& out) {
+			return decode(document, out, options);
+		});
+	}
+
+	if (size(paths) > 1 || !out_dir.empty() ||
+		(size(paths) == 1 && std::filesystem::is_directory(paths.front())))
+	{
+		if (stats || repeated)
+		{
+			std::cerr << "--stats and --repeat time one document, not --out or several files\n";
+			return EXIT_FAILURE;
+		}
+		std::ios_base::sync_with_stdio(false);
+		return decode_files(paths, out_dir, jobs, options);
+	}
+
+	const auto path = empty(paths) ? std::string_view{} : paths.front();
+	if (stats)
+	{
+		std::ios_base::sync_with_stdio(false);
+		return decode_stats(path, options, repeat);
+	}
+
+	auto input = json::PaddedString{};
 	auto toml_node = std::optional<toml::root_node>{};
 
 	try
 	{
 		std::ios_base::sync_with_stdio(false);
 	#if 1
-		toml_node = toml::parse(std::cin);
+		input = empty(path) ? json::PaddedString::ReadStdin() : json::PaddedString::ReadFile(std::string{ path });
+		check_nesting(input, options.max_depth);
+		toml_node = toml::parse(std::string_view{ input });
 	#elif 1
 		// nothrow
 		auto toml_node = toml::parse(std::cin, toml::no_throw);
@@ -41,9 +130,6 @@ int main(int argc, char** args)
 		auto toml_node = toml::parse(str, toml::no_throw);
 		if (!toml_node.good())
 			return EXIT_FAILURE;
-	#elif 1
-		const auto file = std::filesystem::path{ "bad-utf8-in-multiline.toml" };
-		auto toml_node = toml::parse(file);
 	#else
 		// use the string defined above as input
 		auto toml_node = toml::parse(str);
@@ -63,7 +149,13 @@ int main(int argc, char** args)
 	// because the error was triggered by the json outputter rather than another toml
 	try
 	{
-		stream_to_json(std::cout, *toml_node);
+		if (!output_json(std::cout, std::cerr, *toml_node, options))
+			return EXIT_FAILURE;
+	}
+	catch (const nesting_too_deep& e)
+	{
+		std::cerr << e.what();
+		return EXIT_FAILURE;
 	}
 	catch (const std::exception&)
 	{
@@ -73,99 +165,250 @@ int main(int argc, char** args)
 	return EXIT_SUCCESS;
 }
 
-constexpr auto value_strings = std::array{
-	"string"sv, "integer"sv, "float"sv, "bool"sv,
-	"datetime"sv, "datetime-local"sv, "date-local"sv,
-	"time-local"sv, "unknown"sv, "bad"sv, "out-of-range"sv
-};
-
-constexpr std::string_view value_to_string(const toml::value_type v)
+// whether p is dir or somewhere below it, going by the paths alone
+static bool is_under(const std::filesystem::path& p, const std::filesystem::path& dir)
 {
-	assert(static_cast<std::size_t>(v) < size(value_strings));
-	return value_strings[static_cast<std::size_t>(v)];
+	const auto rel = p.lexically_normal().lexically_relative(dir.lexically_normal());
+	return !rel.empty() && *rel.begin() != "..";
 }
 
-json::JSON stream_array(const toml::node&);
+// Decodes files on jobs threads (0 for one per core); a thread takes
+// the next file as soon as it's done with one, biggest files first.
+// With out_dir each file's json goes under it, with a .json extension:
+// a file in a directory argument at its path within that directory,
+// any other at its path from the current directory. Files outside the
+// current directory, or two going to the same place, fail the whole
+// run before anything is decoded. Without out_dir the json goes to
+// stdout. Either way, stdout
+// has a frame per file as serve.hpp describes, named with its path,
+// in the order the files were given: the json, or nothing if it went
+// to out_dir, or why the file failed.
+int decode_files(const std::vector<std::string_view>& args, const std::filesystem::path& out_dir,
+	unsigned jobs, const decode_options& options)
+{
+	namespace fs = std::filesystem;
 
-template<bool R>
-void stream_table(json::JSON&, const toml::basic_node<R>&);
+	struct file
+	{
+		fs::path in, out;
+		std::uintmax_t size = 0;
+	};
 
-using toml::to_escaped_string;
+	auto files = std::vector<file>{};
+	for (const auto arg : args)
+	{
+		const auto p = fs::path{ arg };
+		if (fs::is_directory(p))
+		{
+			auto found = std::vector<fs::path>{};
+			for (const auto& entry : fs::recursive_directory_iterator{ p })
+			{
+				if (entry.is_regular_file() && entry.path().extension() == ".toml")
+					found.push_back(entry.path());
+			}
+			std::sort(begin(found), end(found));
+			for (auto& f : found)
+				files.push_back({ f, f.lexically_relative(p) });
+		}
+		else
+			files.push_back({ p, fs::absolute(p).lexically_normal().lexically_relative(fs::current_path()) });
+	}
 
-json::JSON stream_value(const toml::node& n)
-{
-	if (n.array())
-		return stream_array(n);
-	else if (n.inline_table())
+	auto placed = std::map<fs::path, const fs::path*>{};
+	for (auto& f : files)
+	{
+		auto ec = std::error_code{};
+		f.size = fs::file_size(f.in, ec);
+		if (out_dir.empty())
+			continue;
+
+		if (f.out.empty() || *f.out.begin() == "..")
+		{
+			std::cerr << f.in.string() << " is outside the current directory, so has no place under "
+				<< out_dir.string() << '\n';
+			return EXIT_FAILURE;
+		}
+
+		f.out = (out_dir / f.out.replace_extension(".json")).lexically_normal();
+		if (!is_under(f.out, out_dir))
+		{
+			std::cerr << f.in.string() << " would be written to " << f.out.string() << ", outside "
+				<< out_dir.string() << '\n';
+			return EXIT_FAILURE;
+		}
+		if (const auto [it, added] = placed.emplace(f.out, &f.in); !added)
+		{
+			std::cerr << f.in.string() << " and " << it->second->string() << " would both be written to "
+				<< f.out.string() << '\n';
+			return EXIT_FAILURE;
+		}
+	}
+
+	auto order = std::vector<std::size_t>(size(files));
+	std::iota(begin(order), end(order), std::size_t{});
+	std::stable_sort(begin(order), end(order), [&](auto a, auto b) {
+		return files[a].size > files[b].size;
+	});
+
+	struct result
+	{
+		bool done = false, ok = false;
+		std::string text;
+	};
+
+	auto results = std::vector<result>(size(files));
+	auto next = std::atomic<std::size_t>{};
+	auto lock = std::mutex{};
+	auto finished = std::condition_variable{};
+
+	const auto work = [&] {
+		auto out = std::ostringstream{};
+		for (auto i = next++; i < size(order); i = next++)
+		{
+			const auto& f = files[order[i]];
+			out.str({});
+			auto ok = false;
+			try
+			{
+				const auto input = json::PaddedString::ReadFile(f.in.string());
+				ok = decode(input, out, options);
+			}
+			catch (const std::exception& e)
+			{
+				out << e.what();
+			}
+
+			auto text = out.str();
+			if (ok && !out_dir.empty())
+			{
+				auto ec = std::error_code{};
+				fs::create_directories(f.out.parent_path(), ec);
+				auto strm = std::ofstream{ f.out, std::ios::binary };
+				if (strm.write(data(text), static_cast<std::streamsize>(size(text))))
+					text.clear();
+				else
+				{
+					ok = false;
+					text = "could not write " + f.out.string();
+				}
+			}
+
+			{
+				const auto guard = std::lock_guard{ lock };
+				results[order[i]] = { true, ok, std::move(text) };
+			}
+			finished.notify_all();
+		}
+	};
+
+	if (jobs == 0)
+		jobs = std::max(1u, std::thread::hardware_concurrency());
+	jobs = static_cast<unsigned>(std::min<std::size_t>(jobs, std::max<std::size_t>(size(files), 1)));
+
+	auto threads = std::vector<std::thread>{};
+	for (auto t = 0u; t < jobs; ++t)
+		threads.emplace_back(work);
+
+	// each result is written as soon as those before it are, then dropped
+	auto failed = false;
+	for (auto i = std::size_t{}; i < size(files); ++i)
 	{
-		auto tab = json::Object();
-		stream_table(tab, n);
-		return tab;
+		auto r = result{};
+		{
+			auto guard = std::unique_lock{ lock };
+			finished.wait(guard, [&] { return results[i].done; });
+			r = std::move(results[i]);
+		}
+		write_frame(std::cout, r.ok, r.text, files[i].in.string());
+		failed |= !r.ok;
 	}
 
-	auto val = json::Object();
-	val["type"] = to_escaped_string(std::string{ value_to_string(n.type()) });
-	if (n.type() == toml::value_type::string)
-		val["value"] = to_escaped_string(n.as_string());
-	else if (n.type() == toml::value_type::integer)
-		val["value"] = n.as_string(toml::int_base::dec);
-	else if (n.type() == toml::value_type::floating_point)
-		val["value"] = n.as_string(toml::float_rep::default, 19);
-	else
-		val["value"] = n.as_string();
-
-	return val;
+	for (auto& t : threads)
+		t.join();
+
+	return failed ? EXIT_FAILURE : EXIT_SUCCESS;
 }
 
-json::JSON stream_array(const toml::node& n)
+// every node in the tree: tables, keys, arrays and values
+static std::size_t count_nodes(const toml::root_node& root)
 {
-	auto arr = json::Array();
+	auto count = std::size_t{ 1 };
+	auto next = std::vector<toml::node>{};
+	if (root.has_children())
+		next.push_back(root.get_first_child());
 
-	for (const auto& basic_node : n)
+	while (!empty(next))
 	{
-		assert(basic_node.good());
-		auto elm = stream_value(basic_node);
-		arr.append(elm);
+		const auto n = std::move(next.back());
+		next.pop_back();
+		++count;
+		if (n.has_sibling())
+			next.push_back(n.get_next_sibling());
+		if (n.has_children())
+			next.push_back(n.get_first_child());
 	}
-
-	return arr;
+	return count;
 }
 
-template<bool Root>
-void stream_table(json::JSON& json, const toml::basic_node<Root>& n)
+// Decodes the file at path, or stdin, repeat times, timing each stage,
+// then writes the stats to stderr. Unlike a plain run, an error while
+// writing json fails the run too.
+int decode_stats(const std::string_view path, const decode_options& options, const unsigned repeat)
 {
-	for (const auto& basic_node : n)
+	auto stats = run_stats{};
+	stats.tool = "toml-test-decoder"sv;
+	stats.input = path;
+	stats.repeat = repeat;
+	stats.stages = { { "read"sv }, { "parse"sv }, { "convert"sv }, { "output"sv } };
+	auto& read = stats.stages[0];
+	auto& parse = stats.stages[1];
+	auto& convert = stats.stages[2];
+	auto& output = stats.stages[3];
+
+	auto input = json::PaddedString{};
+	auto text = std::ostringstream{};
+	try
 	{
-		assert(basic_node.good());
-		if(basic_node.table())
-		{
-			auto tab = json::Object();
-			stream_table(tab, basic_node);
-			json[to_escaped_string(basic_node.as_string())] = tab;
-		}
-		else if(basic_node.key())
-		{
-			auto val = stream_value(basic_node.get_first_child());
-			json[to_escaped_string(basic_node.as_string())] = val;
-		}
-		else
+		auto ok = true;
+		for (auto i = 0u; ok && i < repeat; ++i)
 		{
-			assert(basic_node.array_table());
-			json::JSON& arr = json[to_escaped_string(basic_node.as_string())];
-			for (const auto& arr_tab : basic_node)
+			if (i == 0 || !empty(path))
 			{
-				auto tab = json::Object();
-				stream_table(tab, arr_tab);
-				arr.append(tab);
+				input = timed(read, [&] {
+					return empty(path) ? json::PaddedString::ReadStdin() : json::PaddedString::ReadFile(std::string{ path });
+				});
 			}
+
+			const auto toml_node = timed(parse, [&] {
+				check_nesting(input, options.max_depth);
+				return toml::parse(std::string_view{ input });
+			});
+			if (i == 0)
+			{
+				stats.bytes_in = input.size();
+				stats.nodes = count_nodes(toml_node);
+			}
+
+			text.str({});
+			ok = timed(convert, [&] { return output_json(text, std::cerr, toml_node, options); });
+
+			if (!ok)
+				break;
+
+			const auto json = text.str();
+			timed(output, [&] {
+				std::cout.write(data(json), static_cast<std::streamsize>(size(json)));
+				std::cout.flush();
+			});
+			stats.bytes_out = size(json);
 		}
+		stats.ok = ok;
+	}
+	catch (const std::exception& e)
+	{
+		std::cerr << e.what() << '\n';
 	}
-}
 
-void stream_to_json(std::ostream& strm, const toml::root_node& n)
-{
-	auto json = json::Object();
-	stream_table(json, n);
-	strm << json;
-	return;
+	write_stats(std::cerr, stats);
+	return stats.ok ? EXIT_SUCCESS : EXIT_FAILURE;
 }
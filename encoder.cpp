@@ -1,12 +1,15 @@
+#include <algorithm>
 #include <array>
-#include <charconv>
 #include <fstream>
 #include <iostream>
 #include <sstream>
 #include <string_view>
-#include <variant>
+#include <type_traits>
 
 #include "json.hpp"
+#include "json_to_toml.hpp"
+#include "serve.hpp"
+#include "stats.hpp"
 
 #include "another_toml/except.hpp"
 #include "another_toml/string_util.hpp"
@@ -16,11 +19,11 @@ using namespace std::string_literals;
 using namespace std::string_view_literals;
 namespace toml = another_toml;
 
-template<bool NoThrow>
-bool convert_json(const json::JSON& j);
-
 void make_file();
 void generate_huge_file();
+template<typename Input>
+int encode(Input&, json_encoder::input);
+int encode_stats(std::string_view, json_encoder::input, unsigned);
 
 constexpr auto in_str = u8R"(
   {
@@ -68,28 +71,72 @@ constexpr auto in_str = u8R"(
 }
 )"sv;
 
-int main()
+int main(int argc, char** argv)
 {
+	// [file]: read the json from a file rather than stdin. A file is read
+	//		whole, with json::PaddedString, before it is parsed; stdin is
+	//		parsed in chunks as it is read.
+	// --dom: load the whole document into a json::JSON tree before converting it,
+	//		rather than converting while it is being parsed.
+	// --tape: the same, but into a read-only json::Tape.
+	// --server: convert framed documents from stdin until it ends, see serve.hpp;
+	//		can be given with --dom or --tape.
+	// --stats: time each stage of encoding one document, and write the
+	//		times as json to stderr, see stats.hpp; can be given with --dom
+	//		or --tape.
+	// --repeat <n>: with --stats, encode it n times.
+	auto use_dom = false, use_tape = false, server = false, stats = false;
+	auto path = std::string_view{};
+	auto repeat = 1u;
+	for (auto i = 1; i < argc; ++i)
+	{
+		const auto arg = std::string_view{ argv[i] };
+		use_dom |= arg == "--dom"sv;
+		use_tape |= arg == "--tape"sv;
+		server |= arg == "--server"sv;
+		stats |= arg == "--stats"sv;
+		if (arg == "--repeat"sv && i + 1 < argc)
+			repeat = std::max(1u, static_cast<unsigned>(std::strtoul(argv[++i], nullptr, 10)));
+		else if (arg.substr(0, 2) != "--"sv)
+			path = arg;
+	}
+
+	const auto input = use_dom ? json_encoder::input::dom :
+		use_tape ? json_encoder::input::tape : json_encoder::input::stream;
+
+	if (stats)
+	{
+		std::ios_base::sync_with_stdio(false);
+		return encode_stats(path, input, repeat);
+	}
+
+	if (server)
+	{
+		std::ios_base::sync_with_stdio(false);
+		// kept between documents, so their storage is reused
+		auto encoder = json_encoder{ input };
+		return serve(std::cin, std::cout, [&](const std::string& document, std::ostream& out) {
+			return encoder.encode(document, out);
+		});
+	}
+
 	try
 	{
-		auto str = std::string{};
 #if 1
-		auto sstream = std::stringstream{};
-		sstream << std::cin.rdbuf();
-		str = sstream.str();
+		// stdin is often a pipe, and reading it whole would keep all of
+		// it in memory; chunks of it only need as much as the document
+		// being built, if any. A file is mapped or read in one go.
+		if (empty(path))
+			return encode(std::cin, input);
+		auto in = json::PaddedString::ReadFile(std::string{ path });
 #elif 0
 		auto beg = reinterpret_cast<const char*>(&*in_str.begin());
-		auto end = beg + in_str.length();
-		str = std::string{ beg, end };
+		auto in = json::PaddedString{ std::string_view{ beg, in_str.length() } };
 #else
 		make_file();
 		return EXIT_SUCCESS;
 #endif
-		const auto j = json::JSON::Load(str);
-		if (convert_json<false>(j))
-			return EXIT_SUCCESS;
-		else
-			return EXIT_FAILURE;
+		return encode(in, input);
 	}
 	catch (const std::exception& e)
 	{
@@ -98,226 +145,50 @@ int main()
 	}
 }
 
-static std::string lower_string(std::string_view v)
+// encodes one document, from a json::PaddedString read whole, or from
+// a stream read in chunks
+template<typename Input>
+int encode(Input& in, const json_encoder::input input)
 {
-	auto s = std::string{};
-	s.reserve(size(v));
-	std::transform(begin(v), end(v), back_inserter(s), tolower);
-	return s;
-}
+	constexpr auto padded = std::is_same_v<Input, json::PaddedString>;
 
-namespace another_toml
-{
-	std::string to_unescaped_string2(std::string_view str);
-}
-
-using jtype = json::JSON::Class;
-
-template<bool NoThrow>
-bool parse_value(const json::JSON& v, toml::writer& w)
-{
-	const auto& value = v.at("value"s);
-	const auto& type_node = v.at("type"s);
-	const auto type = type_node.ToString();
-	if (type == "string"s)
+	auto success = false;
+	if (input == json_encoder::input::dom)
 	{
-		auto str = value.ToString();
-		w.write_value(toml::to_unescaped_string2(str));
-	}
-	else if (type == "integer"s)
-	{
-		auto integral = int64_t{};
-		const auto str = value.ToString();
-		auto ret = std::from_chars(data(str), data(str) + size(str), integral);
-		if (ret.ec != std::errc{})
-			return false;
-
-		w.write_value(integral);
-	}
-	else if (type == "float"s)
-	{
-		// NOTE: We lowercase the string because toml-test: tests/valid/spec/float-2.json
-		//		provides inv values as "+Inf" rather than "+inf", (possibly a bug in toml-test)
-		//		our api doesn't take floats as string anyway;
-		//		and valid toml files cannot store infinity in uppercase.
-		const auto str = lower_string(value.ToString());
-		const auto ret = toml::parse_float_string(str);
-		assert(ret.error == toml::parse_float_string_return::error_t{});
-		if (ret.representation == toml::float_rep::scientific)
-			w.write_value(ret.value, toml::float_rep::scientific, 20);
-		else
-			w.write_value(ret.value, {}, 20);
-	}
-	else if (type == "bool"s)
-	{
-		const auto str = value.ToString();
-		if (str == "0" ||
-			str == "true")
-			w.write_value(true);
+		auto doc = json::Document{};
+		auto error = json::ParseError{};
+		if constexpr (padded)
+			error = doc.TryLoadInPlace(std::move(in));
 		else
-			w.write_value(false);
-	}
-	else if (type == "datetime"s ||
-		type == "datetime-local"s ||
-		type == "date-local"s ||
-		type == "time-local"s)
-	{
-		const auto var = toml::parse_date_time(value.ToString());
-		return std::visit([&w](auto&& value) {
-			if constexpr (std::is_same_v<std::decay_t<decltype(value)>, std::monostate>)
-				return false;
-			else
-			{
-				w.write_value(value);
-				return true;
-			}
-			}, var);
-	}
-	else
-		return false;
+			error = doc.TryLoad(in);
 
-	return true;
-}
-
-template<bool NoThrow>
-bool parse_array(const json::JSON& a, toml::writer& w)
-{
-	const auto children = a.ArrayRange();
-	for (auto& val : children)
-	{
-		switch (val.JSONType())
+		if (error)
 		{
-		case jtype::Array:
-		{
-			w.begin_array({});
-			parse_array<false>(val, w);
-			w.end_array();
-		}break;
-		case jtype::Object:
-		{
-			//table 
-			if (val.hasKey("type"s) &&
-				val.hasKey("value"s) &&
-				val.size() == 2)
-			{
-				if (!parse_value<NoThrow>(val, w))
-					return false;
-			}
-			else
-			{
-				w.begin_inline_table({});
-				if (!parse_table<NoThrow>(val, w, toml::node_type::inline_table))
-					return false;
-				w.end_inline_table();
-			}
-		}break;
+			report_json_error(std::cerr, error);
+			return EXIT_FAILURE;
 		}
+		success = convert_json<false>(doc.Root(), std::cout);
 	}
-
-	return false;
-}
-
-// if true, arrays are probably arrays of tables
-// 
-// {}
-static bool is_key(const json::JSON& t) noexcept
-{
-	return t.hasKey("type"s) &&
-		t.hasKey("value"s) &&
-		t.size() == 2;
-}
-
-static bool is_table_array(const json::JSON& t)
-{
-	const auto children = t.ArrayRange();
-	if (begin(children) == end(children)) // catch empty arrays, these are probably not table arrays(but empty normal arrays)
-		return false;
-	return std::all_of(begin(children), end(children), [](auto&& val) {
-		return val.JSONType() == jtype::Object && !is_key(val);
-		});
-}
-
-template<bool NoThrow>
-bool parse_table(const json::JSON& t, toml::writer& w, toml::node_type parent_type = toml::node_type::table)
-{
-	const auto children = t.ObjectRange();
-	for (auto& [raw_name, value] : children)
+	else if (input == json_encoder::input::tape)
 	{
-		const auto name = toml::to_unescaped_string2(raw_name);
-		switch (value.JSONType())
+		auto tape = json::Tape{};
+		if (const auto error = tape.Load(in))
 		{
-		case jtype::Array:
-		{
-			if (is_table_array(value))
-			{
-				const auto tables = value.ArrayRange();
-				for (auto& val : tables)
-				{
-					w.begin_array_table(name);
-					parse_table<false>(val, w, toml::node_type::array_tables);
-					w.end_array_table();
-				}
-			}
-			else
-			{
-				w.begin_array(name);
-				parse_array<false>(value, w);
-				w.end_array();
-			}
-		} break;
-		case jtype::Object:
-		{
-			//table 
-			if (value.hasKey("type"s) &&
-				value.hasKey("value"s) &&
-				value.size() == 2)
-			{
-				w.write_key(name);
-				if (!parse_value<NoThrow>(value, w))
-					return false;
-			}
-			else
-			{
-				if (parent_type == toml::node_type::inline_table)
-				{
-					w.begin_inline_table(name);
-					if (!parse_table<NoThrow>(value, w, toml::node_type::inline_table))
-						return false;
-					w.end_inline_table();
-				}
-				else
-				{
-					w.begin_table(name);
-					if (!parse_table<NoThrow>(value, w))
-						return false;
-					w.end_table();
-				}
-			}
-			break;
-		}
-		default:
-			return false;
+			report_json_error(std::cerr, error);
+			return EXIT_FAILURE;
 		}
+		success = convert_json<false>(tape.Root(), std::cout);
 	}
-
-	return true;
-}
-
-template<bool NoThrow>
-bool convert_json(const json::JSON& j)
-{
-	assert(j.JSONType() == jtype::Object);
-	auto writer = toml::writer{};
-	auto opts = toml::writer_options{};
-	opts.skip_empty_tables = false;
-	writer.set_options(opts);
-
-	if (parse_table<NoThrow>(j, writer))
+	else
 	{
-		std::cout << writer;
-		return true;
+		auto reader = json::Reader{ in };
+		success = stream_json<false>(reader, std::cout, std::cerr);
 	}
-	return false;
+
+	if (success)
+		return EXIT_SUCCESS;
+	else
+		return EXIT_FAILURE;
 }
 
 void make_file()
@@ -446,6 +317,117 @@ void make_file()
 	return;
 }
 
+// every value in the json, counting objects and arrays as one each
+static std::size_t count_values(const json::PaddedString& in)
+{
+	using jevent = json::Reader::Event;
+	auto reader = json::Reader{ in };
+	auto count = std::size_t{};
+	while (true)
+	{
+		switch (reader.Next())
+		{
+		case jevent::BeginObject:
+		case jevent::BeginArray:
+		case jevent::String:
+		case jevent::Number:
+		case jevent::Bool:
+		case jevent::Null:
+			++count;
+			break;
+		case jevent::End:
+		case jevent::Error:
+			return count;
+		default:
+			break;
+		}
+	}
+}
+
+// Encodes the file at path, or stdin, repeat times, timing each stage,
+// then writes the stats to stderr. Without --dom or --tape, the json is
+// converted as it's parsed, so there's no parse stage; convert has both.
+int encode_stats(const std::string_view path, const json_encoder::input mode, const unsigned repeat)
+{
+	auto stats = run_stats{};
+	stats.tool = "toml-test-encoder"sv;
+	stats.input = path;
+	stats.repeat = repeat;
+	stats.stages = { { "read"sv }, { "parse"sv }, { "convert"sv }, { "output"sv } };
+	auto& read = stats.stages[0];
+	auto& parse = stats.stages[1];
+	auto& convert = stats.stages[2];
+	auto& output = stats.stages[3];
+
+	// kept between runs, as --server does
+	auto doc = json::Document{};
+	auto tape = json::Tape{};
+	auto in = json::PaddedString{};
+	auto text = std::ostringstream{};
+	try
+	{
+		auto ok = true;
+		for (auto i = 0u; ok && i < repeat; ++i)
+		{
+			if (i == 0 || !empty(path))
+			{
+				in = timed(read, [&] {
+					return empty(path) ? json::PaddedString::ReadStdin() : json::PaddedString::ReadFile(std::string{ path });
+				});
+			}
+
+			if (i == 0)
+			{
+				stats.bytes_in = in.size();
+				stats.nodes = count_values(in);
+			}
+
+			text.str({});
+			if (mode == json_encoder::input::dom)
+			{
+				// in place, as a plain run does, but on a copy, as stdin can't be read again
+				auto copy = json::PaddedString{ std::string_view{ in } };
+				const auto error = timed(parse, [&] { return doc.TryLoadInPlace(std::move(copy)); });
+				if (error)
+					report_json_error(std::cerr, error);
+				ok = !error && timed(convert, [&] { return convert_json<false>(doc.Root(), text); });
+			}
+			else if (mode == json_encoder::input::tape)
+			{
+				const auto error = timed(parse, [&] { return tape.Load(in); });
+				if (error)
+					report_json_error(std::cerr, error);
+				ok = !error && timed(convert, [&] { return convert_json<false>(tape.Root(), text); });
+			}
+			else
+			{
+				ok = timed(convert, [&] {
+					auto reader = json::Reader{ in };
+					return stream_json<false>(reader, text, std::cerr);
+				});
+			}
+
+			if (!ok)
+				break;
+
+			const auto toml_text = text.str();
+			timed(output, [&] {
+				std::cout.write(data(toml_text), static_cast<std::streamsize>(size(toml_text)));
+				std::cout.flush();
+			});
+			stats.bytes_out = size(toml_text);
+		}
+		stats.ok = ok;
+	}
+	catch (const std::exception& e)
+	{
+		std::cerr << e.what() << '\n';
+	}
+
+	write_stats(std::cerr, stats);
+	return stats.ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
 // should be some work for the parser
 // about 1kb of unicode
 constexpr auto unicode_str = u8"\u0000 \u0008 \u000c \u007f  \u0080 \u00ff \ud7ff \ue000 \uffff \U00010000 \U0010ffff"sv;
@@ -0,0 +1,539 @@
+#include <algorithm>
+#include <cassert>
+#include <charconv>
+#include <string_view>
+#include <variant>
+
+#include "json_to_toml.hpp"
+
+#include "another_toml/except.hpp"
+#include "another_toml/string_util.hpp"
+#include "another_toml/writer.hpp"
+
+using namespace std::string_view_literals;
+namespace toml = another_toml;
+
+// the input wasn't json at all; stdin is read in chunks, so there may
+// be no text left to work out a line and column from
+void report_json_error(std::ostream& err, const json::ParseError& e)
+{
+	err << "invalid json: " << e.Message() << " at byte " << e.Offset << '\n';
+}
+
+static std::string lower_string(std::string_view v)
+{
+	auto s = std::string{};
+	s.reserve(size(v));
+	std::transform(begin(v), end(v), back_inserter(s), tolower);
+	return s;
+}
+
+using jtype = json::JSON::Class;
+
+// the tree walking functions take a json::JSON, or a json::Tape::Value
+
+template<bool NoThrow, typename Node>
+bool parse_table(const Node& t, toml::writer& w, toml::node_type parent_type = toml::node_type::table);
+
+// writes a toml-test tagged value, given its "type" and "value" members as plain text
+template<bool NoThrow>
+bool write_value(std::string_view type, std::string_view value, toml::writer& w)
+{
+	if (type == "string"sv)
+		w.write_value(value);
+	else if (type == "integer"sv)
+	{
+		auto integral = int64_t{};
+		auto ret = std::from_chars(data(value), data(value) + size(value), integral);
+		if (ret.ec != std::errc{})
+			return false;
+
+		w.write_value(integral);
+	}
+	else if (type == "float"sv)
+	{
+		// NOTE: We lowercase the string because toml-test: tests/valid/spec/float-2.json
+		//		provides inv values as "+Inf" rather than "+inf", (possibly a bug in toml-test)
+		//		our api doesn't take floats as string anyway;
+		//		and valid toml files cannot store infinity in uppercase.
+		const auto str = lower_string(value);
+		const auto ret = toml::parse_float_string(str);
+		assert(ret.error == toml::parse_float_string_return::error_t{});
+		if (ret.representation == toml::float_rep::scientific)
+			w.write_value(ret.value, toml::float_rep::scientific, 20);
+		else
+			w.write_value(ret.value, {}, 20);
+	}
+	else if (type == "bool"sv)
+	{
+		if (value == "0" ||
+			value == "true")
+			w.write_value(true);
+		else
+			w.write_value(false);
+	}
+	else if (type == "datetime"sv ||
+		type == "datetime-local"sv ||
+		type == "date-local"sv ||
+		type == "time-local"sv)
+	{
+		const auto var = toml::parse_date_time(value);
+		return std::visit([&w](auto&& value) {
+			if constexpr (std::is_same_v<std::decay_t<decltype(value)>, std::monostate>)
+				return false;
+			else
+			{
+				w.write_value(value);
+				return true;
+			}
+			}, var);
+	}
+	else
+		return false;
+
+	return true;
+}
+
+template<bool NoThrow, typename Node>
+bool parse_value(const Node& v, toml::writer& w)
+{
+	// json::JSON::Load and json::Tape make a Tagged node of every leaf with string members
+	if (v.JSONType() == jtype::Tagged)
+		return write_value<NoThrow>(v.TagType(), v.TagValue(), w);
+
+	auto type = std::string{}, value = std::string{};
+	return write_value<NoThrow>(v.at("type"sv).Unescaped(type), v.at("value"sv).Unescaped(value), w);
+}
+
+// if true, arrays are probably arrays of tables
+// 
+// {}
+template<typename Node>
+static bool is_key(const Node& t) noexcept
+{
+	return t.size() == 2 &&
+		t.hasKey("type"sv) &&
+		t.hasKey("value"sv);
+}
+
+template<bool NoThrow, typename Node>
+bool parse_array(const Node& a, toml::writer& w)
+{
+	const auto children = a.ArrayRange();
+	for (const auto& val : children)
+	{
+		switch (val.JSONType())
+		{
+		case jtype::Array:
+		{
+			w.begin_array({});
+			parse_array<false>(val, w);
+			w.end_array();
+		}break;
+		case jtype::Tagged:
+		{
+			if (!parse_value<NoThrow>(val, w))
+				return false;
+		}break;
+		case jtype::Object:
+		{
+			//table 
+			if (is_key(val))
+			{
+				if (!parse_value<NoThrow>(val, w))
+					return false;
+			}
+			else
+			{
+				w.begin_inline_table({});
+				if (!parse_table<NoThrow>(val, w, toml::node_type::inline_table))
+					return false;
+				w.end_inline_table();
+			}
+		}break;
+		}
+	}
+
+	return false;
+}
+
+
+template<typename Node>
+static bool is_table_array(const Node& t)
+{
+	const auto children = t.ArrayRange();
+	if (children.begin() == children.end()) // catch empty arrays, these are probably not table arrays(but empty normal arrays)
+		return false;
+	return std::all_of(children.begin(), children.end(), [](auto&& val) {
+		return val.JSONType() == jtype::Object && !is_key(val);
+		});
+}
+
+template<bool NoThrow, typename Node>
+bool parse_table(const Node& t, toml::writer& w, toml::node_type parent_type)
+{
+	const auto children = t.ObjectRange();
+	for (const auto& [name, value] : children)
+	{
+		switch (value.JSONType())
+		{
+		case jtype::Array:
+		{
+			if (is_table_array(value))
+			{
+				const auto tables = value.ArrayRange();
+				for (const auto& val : tables)
+				{
+					w.begin_array_table(name);
+					parse_table<false>(val, w, toml::node_type::array_tables);
+					w.end_array_table();
+				}
+			}
+			else
+			{
+				w.begin_array(name);
+				parse_array<false>(value, w);
+				w.end_array();
+			}
+		} break;
+		case jtype::Tagged:
+		{
+			w.write_key(name);
+			if (!parse_value<NoThrow>(value, w))
+				return false;
+		} break;
+		case jtype::Object:
+		{
+			//table 
+			if (is_key(value))
+			{
+				w.write_key(name);
+				if (!parse_value<NoThrow>(value, w))
+					return false;
+			}
+			else
+			{
+				if (parent_type == toml::node_type::inline_table)
+				{
+					w.begin_inline_table(name);
+					if (!parse_table<NoThrow>(value, w, toml::node_type::inline_table))
+						return false;
+					w.end_inline_table();
+				}
+				else
+				{
+					w.begin_table(name);
+					if (!parse_table<NoThrow>(value, w))
+						return false;
+					w.end_table();
+				}
+			}
+			break;
+		}
+		default:
+			return false;
+		}
+	}
+
+	return true;
+}
+
+// Streaming conversion: the writer is driven straight from json::Reader
+// events as the input is parsed, whether it is all in memory or read in
+// chunk by chunk from a stream; no tree is built. Only
+// telling tagged values from tables, and arrays of tables from arrays,
+// needs lookahead; that reads ahead and then rewinds the reader to a
+// json::Reader::Mark, which keeps the input from there on in memory.
+
+using jevent = json::Reader::Event;
+
+// if the object just begun is a tagged value, copies out its type and value
+// and returns true
+// otherwise the reader is left where it was
+static bool read_key(json::Reader& r, std::string& type, std::string& value)
+{
+	const auto mark = r.Save();
+	const auto depth = r.Depth();
+	auto has_type = false, has_value = false;
+	while (true)
+	{
+		const auto e = r.Next();
+		if (e == jevent::EndObject)
+			break;
+
+		if (e != jevent::Key)
+		{
+			r.Restore(mark);
+			return false;
+		}
+
+		const auto key = r.Text();
+		auto& member = key == "type"sv ? type : value;
+		if (key == "type"sv)
+			has_type = true;
+		else if (key == "value"sv)
+			has_value = true;
+		else
+		{
+			r.Restore(mark);
+			return false;
+		}
+
+		// non-string members read as empty, as they do from a json::JSON
+		member.clear();
+		switch (r.Next())
+		{
+		case jevent::String:
+			if (r.HasEscapes())
+				r.Unescaped(member);
+			else
+				member.assign(r.Text());
+			break;
+		case jevent::BeginObject:
+		case jevent::BeginArray:
+			r.SkipTo(depth);
+			break;
+		case jevent::End:
+		case jevent::Error:
+			r.Restore(mark);
+			return false;
+		default:
+			break;
+		}
+	}
+
+	if (has_type && has_value)
+	{
+		r.Release(mark);
+		return true;
+	}
+
+	r.Restore(mark);
+	return false;
+}
+
+// same as is_table_array, for the array just begun; doesn't move the reader
+static bool is_table_array(json::Reader& r)
+{
+	const auto mark = r.Save();
+	const auto depth = r.Depth();
+	auto type = std::string{}, value = std::string{};
+	auto tables = 0;
+	auto result = false;
+	while (true)
+	{
+		const auto e = r.Next();
+		if (e == jevent::EndArray)
+		{
+			result = tables != 0;
+			break;
+		}
+		if (e != jevent::BeginObject || read_key(r, type, value))
+			break;
+		r.SkipTo(depth);
+		++tables;
+	}
+
+	r.Restore(mark);
+	return result;
+}
+
+template<bool NoThrow>
+bool stream_table(json::Reader& r, toml::writer& w, toml::node_type parent_type = toml::node_type::table);
+
+template<bool NoThrow>
+bool stream_array(json::Reader& r, toml::writer& w)
+{
+	auto type = std::string{}, value = std::string{};
+	while (true)
+	{
+		switch (r.Next())
+		{
+		case jevent::EndArray:
+			return true;
+		case jevent::BeginArray:
+		{
+			const auto depth = r.Depth();
+			w.begin_array({});
+			stream_array<false>(r, w);
+			r.SkipTo(depth - 1);
+			w.end_array();
+		}break;
+		case jevent::BeginObject:
+		{
+			if (read_key(r, type, value))
+			{
+				if (!write_value<NoThrow>(type, value, w))
+					return false;
+			}
+			else
+			{
+				w.begin_inline_table({});
+				if (!stream_table<NoThrow>(r, w, toml::node_type::inline_table))
+					return false;
+				w.end_inline_table();
+			}
+		}break;
+		case jevent::End:
+		case jevent::Error:
+			return false;
+		default:
+			break;
+		}
+	}
+}
+
+template<bool NoThrow>
+bool stream_table(json::Reader& r, toml::writer& w, toml::node_type parent_type)
+{
+	auto buffer = std::string{};
+	auto type = std::string{}, value = std::string{};
+	while (true)
+	{
+		const auto e = r.Next();
+		if (e == jevent::EndObject)
+			return true;
+		if (e != jevent::Key)
+			return false;
+
+		// the reader drops text it has gone past, the key has to be kept
+		if (r.HasEscapes())
+			r.Unescaped(buffer);
+		else
+			buffer.assign(r.Text());
+		const auto name = std::string_view{ buffer };
+		switch (r.Next())
+		{
+		case jevent::BeginArray:
+		{
+			const auto depth = r.Depth();
+			if (is_table_array(r))
+			{
+				while (r.Next() == jevent::BeginObject)
+				{
+					w.begin_array_table(name);
+					stream_table<false>(r, w, toml::node_type::array_tables);
+					r.SkipTo(depth);
+					w.end_array_table();
+				}
+			}
+			else
+			{
+				w.begin_array(name);
+				stream_array<false>(r, w);
+				r.SkipTo(depth - 1);
+				w.end_array();
+			}
+		} break;
+		case jevent::BeginObject:
+		{
+			//table 
+			if (read_key(r, type, value))
+			{
+				w.write_key(name);
+				if (!write_value<NoThrow>(type, value, w))
+					return false;
+			}
+			else
+			{
+				if (parent_type == toml::node_type::inline_table)
+				{
+					w.begin_inline_table(name);
+					if (!stream_table<NoThrow>(r, w, toml::node_type::inline_table))
+						return false;
+					w.end_inline_table();
+				}
+				else
+				{
+					w.begin_table(name);
+					if (!stream_table<NoThrow>(r, w))
+						return false;
+					w.end_table();
+				}
+			}
+			break;
+		}
+		default:
+			return false;
+		}
+	}
+}
+
+template<bool NoThrow>
+bool stream_json(json::Reader& reader, std::ostream& out, std::ostream& err)
+{
+	auto writer = toml::writer{};
+	auto opts = toml::writer_options{};
+	opts.skip_empty_tables = false;
+	writer.set_options(opts);
+
+	if (reader.Next() == jevent::BeginObject &&
+		stream_table<NoThrow>(reader, writer) &&
+		reader.Next() == jevent::End)
+	{
+		out << writer;
+		return true;
+	}
+
+	if (reader.Error())
+		report_json_error(err, reader.Error());
+	return false;
+}
+
+template<bool NoThrow, typename Node>
+bool convert_json(const Node& j, std::ostream& out)
+{
+	// a toml document is a table, so the root must be an object; a
+	// toml-test leaf loaded as a Tagged node isn't one
+	if (j.JSONType() != jtype::Object)
+		return false;
+
+	auto writer = toml::writer{};
+	auto opts = toml::writer_options{};
+	opts.skip_empty_tables = false;
+	writer.set_options(opts);
+
+	if (parse_table<NoThrow>(j, writer))
+	{
+		out << writer;
+		return true;
+	}
+	return false;
+}
+
+template bool stream_json<false>(json::Reader&, std::ostream&, std::ostream&);
+template bool convert_json<false>(const json::JSON&, std::ostream&);
+template bool convert_json<false>(const json::Tape::Value&, std::ostream&);
+
+bool json_encoder::encode(const std::string& document, std::ostream& out)
+{
+	try
+	{
+		if (_input == input::dom)
+		{
+			if (const auto error = _doc.TryLoad(document))
+			{
+				report_json_error(out, error);
+				return false;
+			}
+			return convert_json<false>(_doc.Root(), out);
+		}
+		else if (_input == input::tape)
+		{
+			if (const auto error = _tape.Load(document))
+			{
+				report_json_error(out, error);
+				return false;
+			}
+			return convert_json<false>(_tape.Root(), out);
+		}
+
+		auto reader = json::Reader{ std::string_view{ document } };
+		return stream_json<false>(reader, out, out);
+	}
+	catch (const std::exception& e)
+	{
+		out << e.what();
+		return false;
+	}
+}
@@ -0,0 +1,47 @@
+#ifndef TOML_TEST_JSON_TO_TOML_HPP
+#define TOML_TEST_JSON_TO_TOML_HPP
+
+#include <ostream>
+#include <string>
+
+#include "json.hpp"
+
+// toml-test's json, converted to toml; what toml-test-encoder does, for
+// it and for toml-test-runner
+
+// the input wasn't json at all
+void report_json_error(std::ostream& err, const json::ParseError& e);
+
+// converts the document the reader is over as its events come in
+template<bool NoThrow>
+bool stream_json(json::Reader& reader, std::ostream& out, std::ostream& err);
+
+// converts a document already loaded, as a json::JSON or json::Tape::Value;
+// fails if its root isn't an object
+template<bool NoThrow, typename Node>
+bool convert_json(const Node& j, std::ostream& out);
+
+// Converts json documents one after another, keeping the loaded
+// document's storage from one to the next. On failure, the reason is
+// written to out.
+class json_encoder
+{
+public:
+	enum class input
+	{
+		stream,	// converted as it's parsed, see stream_json
+		dom,	// loaded into a json::Document first
+		tape	// loaded into a json::Tape first
+	};
+
+	explicit json_encoder(input i = input::stream) noexcept : _input{ i } {}
+
+	bool encode(const std::string& document, std::ostream& out);
+
+private:
+	input _input;
+	json::Document _doc;
+	json::Tape _tape;
+};
+
+#endif
@@ -0,0 +1,91 @@
+#!/usr/bin/env python3
+"""Replays a corpus through a toml-test tool's --server mode.
+
+Runs every document once with a process of its own, the way toml-test
+does, and once more through a single --server process, then reports
+documents per second for each. The two runs must agree on every
+document's status, and on the output of those that succeed.
+
+Usage: replay.py <toml-test-decoder|toml-test-encoder> <corpus dir> [tool option...]
+
+Documents are the .toml files under the corpus directory for the
+decoder, and the .json files for the encoder. Tool options such as
+--dom are passed to both runs.
+"""
+
+import os
+import subprocess
+import sys
+import time
+
+
+def documents(root, ext):
+    found = []
+    for path, _, files in os.walk(root):
+        found += [os.path.join(path, f) for f in files if f.endswith(ext)]
+    return sorted(found)
+
+
+def one_per_process(tool, options, texts):
+    results = []
+    for text in texts:
+        run = subprocess.run([tool] + options, input=text,
+                             stdout=subprocess.PIPE, stderr=subprocess.DEVNULL)
+        results.append((run.returncode == 0, run.stdout))
+    return results
+
+
+def server(tool, options, texts):
+    proc = subprocess.Popen([tool, '--server'] + options,
+                            stdin=subprocess.PIPE, stdout=subprocess.PIPE)
+    results = []
+    for text in texts:
+        proc.stdin.write(b'%d\n' % len(text) + text)
+        proc.stdin.flush()
+        status, length = proc.stdout.readline().split()
+        results.append((status == b'ok', proc.stdout.read(int(length))))
+    proc.stdin.close()
+    if proc.wait() != 0:
+        sys.exit('server exited with %d' % proc.returncode)
+    return results
+
+
+def timed(f, *args):
+    start = time.perf_counter()
+    results = f(*args)
+    return results, time.perf_counter() - start
+
+
+def main():
+    if len(sys.argv) < 3:
+        sys.exit(__doc__)
+    tool, root, options = sys.argv[1], sys.argv[2], sys.argv[3:]
+    ext = '.json' if 'encoder' in os.path.basename(tool) else '.toml'
+
+    paths = documents(root, ext)
+    if not paths:
+        sys.exit('no %s files under %s' % (ext, root))
+    texts = []
+    for p in paths:
+        with open(p, 'rb') as f:
+            texts.append(f.read())
+
+    baseline, base_seconds = timed(one_per_process, tool, options, texts)
+    served, served_seconds = timed(server, tool, options, texts)
+
+    # failures say why in different places, so only their status is compared
+    differ = [p for p, a, b in zip(paths, baseline, served)
+              if a[0] != b[0] or (a[0] and a[1] != b[1])]
+    for p in differ[:10]:
+        print('differs: %s' % p)
+
+    n = len(texts)
+    print('%d documents, %d failed' % (n, sum(1 for ok, _ in baseline if not ok)))
+    print('%-20s %10.1f docs/s' % ('process per document', n / base_seconds))
+    print('%-20s %10.1f docs/s' % ('--server', n / served_seconds))
+    print('%-20s %10.1fx' % ('speedup', base_seconds / served_seconds))
+    return 1 if differ else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
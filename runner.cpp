@@ -0,0 +1,387 @@
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#include "json.hpp"
+#include "json_to_toml.hpp"
+#include "toml_to_json.hpp"
+
+using namespace std::string_literals;
+using namespace std::string_view_literals;
+namespace fs = std::filesystem;
+
+// Runs a toml-test corpus in process, rather than through toml-test and a
+// process per case. Every toml file under valid/ is decoded and compared
+// with the json next to it, every toml file under invalid/ must fail to
+// decode, and every json file under valid/ is encoded, decoded again and
+// compared with itself. Cases are spread over a thread per core, and the
+// comparisons follow toml-test's rules, see same_json.
+//
+// Usage: toml-test-runner <corpus> [--decoder | --encoder] [--jobs n]
+//		[--run text] [--verbose]
+//
+// corpus is toml-test's tests directory, or the directory it is in.
+// --run keeps only cases whose name contains text; --verbose lists every
+// case with its time, not just the failures.
+
+enum class case_kind
+{
+	decode_valid,
+	decode_invalid,
+	encode_valid
+};
+
+constexpr std::string_view kind_names[] = { "decoder"sv, "decoder"sv, "encoder"sv };
+
+struct test_case
+{
+	case_kind kind;
+	fs::path input, expected;
+	std::string name;	// the input's path under the corpus, without extension
+};
+
+struct case_result
+{
+	bool pass = false;
+	double seconds = 0;
+	std::string why;	// for failures
+};
+
+static std::vector<test_case> find_cases(const fs::path& corpus, const bool decoder, const bool encoder,
+	const std::string_view filter)
+{
+	auto cases = std::vector<test_case>{};
+	const auto add = [&](const case_kind kind, const fs::path& file, fs::path expected) {
+		auto name = file.lexically_relative(corpus).replace_extension().generic_string();
+		if (name.find(filter) != std::string::npos)
+			cases.push_back({ kind, file, std::move(expected), std::move(name) });
+	};
+
+	for (const auto& dir : { "valid"sv, "invalid"sv })
+	{
+		const auto root = corpus / dir;
+		if (!fs::is_directory(root))
+			continue;
+
+		for (const auto& entry : fs::recursive_directory_iterator{ root })
+		{
+			if (!entry.is_regular_file())
+				continue;
+
+			const auto& file = entry.path();
+			if (dir == "invalid"sv)
+			{
+				if (decoder && file.extension() == ".toml")
+					add(case_kind::decode_invalid, file, {});
+			}
+			else if (decoder && file.extension() == ".toml")
+			{
+				auto expected = fs::path{ file }.replace_extension(".json");
+				if (fs::exists(expected))
+					add(case_kind::decode_valid, file, std::move(expected));
+			}
+			else if (encoder && file.extension() == ".json")
+				add(case_kind::encode_valid, file, file);
+		}
+	}
+
+	std::sort(begin(cases), end(cases), [](const test_case& a, const test_case& b) {
+		return std::tie(a.name, a.kind) < std::tie(b.name, b.kind);
+	});
+	return cases;
+}
+
+// toml-test writes datetimes in whichever form the toml had them; this is
+// the form they compare in: upper case, a 'T' between date and time, 'Z'
+// for a zero offset, and no trailing zeros in fractional seconds
+static std::string normal_datetime(const std::string_view v)
+{
+	auto s = std::string{ v };
+	std::transform(begin(s), end(s), begin(s), [](unsigned char c) { return static_cast<char>(std::toupper(c)); });
+	if (size(s) > 10 && s[10] == ' ')
+		s[10] = 'T';
+	if (size(s) > 6 && (s.compare(size(s) - 6, 6, "+00:00") == 0 || s.compare(size(s) - 6, 6, "-00:00") == 0))
+		s.replace(size(s) - 6, 6, "Z");
+
+	if (const auto dot = s.find('.'); dot != std::string::npos)
+	{
+		auto digits_end = s.find_first_not_of("0123456789", dot + 1);
+		if (digits_end == std::string::npos)
+			digits_end = size(s);
+		auto last = digits_end;
+		while (last > dot + 1 && s[last - 1] == '0')
+			--last;
+		if (last == dot + 1)
+			last = dot;
+		s.erase(last, digits_end - last);
+	}
+	return s;
+}
+
+// values of the same type compare by what they mean, not how they're written
+static bool same_value(const std::string_view type, const std::string_view want, const std::string_view have)
+{
+	if (type == "integer"sv)
+	{
+		auto a = std::int64_t{}, b = std::int64_t{};
+		const auto ra = std::from_chars(data(want), data(want) + size(want), a);
+		const auto rb = std::from_chars(data(have), data(have) + size(have), b);
+		if (ra.ec == std::errc{} && rb.ec == std::errc{})
+			return a == b;
+	}
+	else if (type == "float"sv)
+	{
+		// strtod takes inf and nan in any case, with or without a sign
+		const auto a = std::strtod(std::string{ want }.c_str(), nullptr);
+		const auto b = std::strtod(std::string{ have }.c_str(), nullptr);
+		if (std::isnan(a) || std::isnan(b))
+			return std::isnan(a) && std::isnan(b);
+		return a == b;
+	}
+	else if (type == "datetime"sv || type == "datetime-local"sv ||
+		type == "date-local"sv || type == "time-local"sv)
+		return normal_datetime(want) == normal_datetime(have);
+
+	return want == have;
+}
+
+// toml-test's comparison: tables by their keys in any order, arrays
+// element by element, and values by type, then by same_value; where
+// says where the first difference is
+static bool same_json(const json::JSON& want, const json::JSON& have, std::string& where)
+{
+	using jtype = json::JSON::Class;
+	switch (want.JSONType())
+	{
+	case jtype::Tagged:
+		if (have.JSONType() != jtype::Tagged || have.TagType() != want.TagType())
+		{
+			where += ": expected a value of type " + std::string{ want.TagType() };
+			return false;
+		}
+		if (!same_value(want.TagType(), want.TagValue(), have.TagValue()))
+		{
+			where += ": expected " + std::string{ want.TagValue() } + ", not " + std::string{ have.TagValue() };
+			return false;
+		}
+		return true;
+	case jtype::Object:
+		if (have.JSONType() != jtype::Object)
+		{
+			where += ": expected a table";
+			return false;
+		}
+		for (const auto& [key, value] : want.ObjectRange())
+		{
+			if (!have.hasKey(key))
+			{
+				where += "." + key + ": missing";
+				return false;
+			}
+			where += "." + key;
+			if (!same_json(value, have.at(key), where))
+				return false;
+			where.resize(size(where) - size(key) - 1);
+		}
+		if (have.size() != want.size())
+		{
+			where += ": has keys that aren't expected";
+			return false;
+		}
+		return true;
+	case jtype::Array:
+	{
+		if (have.JSONType() != jtype::Array || have.length() != want.length())
+		{
+			where += ": expected an array of " + std::to_string(want.length());
+			return false;
+		}
+		auto i = 0u;
+		for (const auto& value : want.ArrayRange())
+		{
+			const auto index = "[" + std::to_string(i) + "]";
+			where += index;
+			if (!same_json(value, have.at(i++), where))
+				return false;
+			where.resize(size(where) - size(index));
+		}
+		return true;
+	}
+	default:
+		where += ": not a toml-test value";
+		return false;
+	}
+}
+
+// compares json text with the expected document; false with the reason in why
+static bool check_json(const json::JSON& expected, const std::string& text, std::string& why)
+{
+	const auto have = json::JSON::TryLoad(text);
+	if (!have.Ok())
+	{
+		why = "output isn't json: "s + have.Error.Message();
+		return false;
+	}
+
+	auto where = std::string{ "root" };
+	if (same_json(expected, have.Value, where))
+		return true;
+	why = std::move(where);
+	return false;
+}
+
+static case_result run_case(const test_case& c, json_encoder& encoder)
+{
+	auto result = case_result{};
+	const auto start = std::chrono::steady_clock::now();
+	try
+	{
+		const auto input = json::PaddedString::ReadFile(c.input.string());
+		auto out = std::ostringstream{};
+		switch (c.kind)
+		{
+		case case_kind::decode_invalid:
+			result.pass = !decode(input, out);
+			if (!result.pass)
+				result.why = "invalid toml was accepted";
+			break;
+		case case_kind::decode_valid:
+		{
+			const auto expected = json::JSON::TryLoad(json::PaddedString::ReadFile(c.expected.string()));
+			if (!expected.Ok())
+				result.why = "expected json doesn't load: "s + expected.Error.Message();
+			else if (!decode(input, out))
+				result.why = "decoder failed: " + out.str();
+			else
+				result.pass = check_json(expected.Value, out.str(), result.why);
+		}break;
+		case case_kind::encode_valid:
+		{
+			// toml-test checks the encoder's toml by decoding it; this uses
+			// the decoder for that, rather than toml-test's own
+			const auto document = std::string{ std::string_view{ input } };
+			const auto expected = json::JSON::TryLoad(input);
+			auto decoded = std::ostringstream{};
+			if (!expected.Ok())
+				result.why = "input json doesn't load: "s + expected.Error.Message();
+			else if (!encoder.encode(document, out))
+				result.why = "encoder failed: " + out.str();
+			else if (!decode(out.str(), decoded))
+				result.why = "encoder output doesn't decode: " + decoded.str();
+			else
+				result.pass = check_json(expected.Value, decoded.str(), result.why);
+		}break;
+		}
+	}
+	catch (const std::exception& e)
+	{
+		result.pass = false;
+		result.why = e.what();
+	}
+
+	result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	return result;
+}
+
+int main(int argc, char** argv)
+{
+	auto corpus = fs::path{};
+	auto decoder = true, encoder = true, verbose = false;
+	auto jobs = 0u;
+	auto filter = std::string_view{};
+	for (auto i = 1; i < argc; ++i)
+	{
+		const auto arg = std::string_view{ argv[i] };
+		if (arg == "--decoder"sv)
+			encoder = false;
+		else if (arg == "--encoder"sv)
+			decoder = false;
+		else if (arg == "--verbose"sv)
+			verbose = true;
+		else if (arg == "--jobs"sv && i + 1 < argc)
+			jobs = static_cast<unsigned>(std::strtoul(argv[++i], nullptr, 10));
+		else if (arg == "--run"sv && i + 1 < argc)
+			filter = argv[++i];
+		else if (arg.substr(0, 2) != "--"sv)
+			corpus = arg;
+	}
+
+	if (corpus.empty())
+	{
+		std::cerr << "usage: toml-test-runner <corpus> [--decoder | --encoder] [--jobs n] [--run text] [--verbose]\n";
+		return EXIT_FAILURE;
+	}
+	if (fs::is_directory(corpus / "tests"))
+		corpus /= "tests";
+
+	const auto cases = find_cases(corpus, decoder, encoder, filter);
+	if (empty(cases))
+	{
+		std::cerr << "no cases under " << corpus.string() << '\n';
+		return EXIT_FAILURE;
+	}
+
+	if (jobs == 0)
+		jobs = std::max(1u, std::thread::hardware_concurrency());
+	jobs = static_cast<unsigned>(std::min<std::size_t>(jobs, size(cases)));
+
+	// as toml-test-decoder does files, a thread takes the next case as soon
+	// as it's done with one
+	auto results = std::vector<case_result>(size(cases));
+	auto next = std::atomic<std::size_t>{};
+	const auto start = std::chrono::steady_clock::now();
+	auto threads = std::vector<std::thread>{};
+	for (auto t = 0u; t < jobs; ++t)
+	{
+		threads.emplace_back([&] {
+			auto encoder = json_encoder{};
+			for (auto i = next++; i < size(cases); i = next++)
+				results[i] = run_case(cases[i], encoder);
+		});
+	}
+	for (auto& t : threads)
+		t.join();
+	const auto wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	std::size_t passed[3] = {}, failed[3] = {};
+	for (auto i = std::size_t{}; i < size(cases); ++i)
+	{
+		const auto& c = cases[i];
+		const auto& r = results[i];
+		const auto kind = static_cast<std::size_t>(c.kind);
+		++(r.pass ? passed : failed)[kind];
+		if (verbose || !r.pass)
+		{
+			std::printf("%s %9.3f ms  %-7s %s%s%s\n", r.pass ? "PASS" : "FAIL", r.seconds * 1e3,
+				kind_names[kind].data(), c.name.c_str(), r.pass ? "" : "\n       ", r.why.c_str());
+		}
+	}
+
+	auto times = std::vector<double>(size(results));
+	std::transform(begin(results), end(results), begin(times), [](const case_result& r) { return r.seconds; });
+	std::sort(begin(times), end(times));
+	const auto percentile = [&](const double p) {
+		return times[std::min(size(times) - 1, static_cast<std::size_t>(p * size(times)))] * 1e3;
+	};
+
+	std::printf("\ndecoder: %zu passed, %zu failed; invalid toml: %zu passed, %zu failed\n",
+		passed[0], failed[0], passed[1], failed[1]);
+	std::printf("encoder: %zu passed, %zu failed\n", passed[2], failed[2]);
+	std::printf("%zu cases in %.3f s on %u threads; per case p50 %.3f ms, p99 %.3f ms, max %.3f ms\n",
+		size(cases), wall, jobs, percentile(0.5), percentile(0.99), times.back() * 1e3);
+
+	return failed[0] + failed[1] + failed[2] == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,66 @@
+#ifndef TOML_TEST_SERVE_HPP
+#define TOML_TEST_SERVE_HPP
+
+#include <cstdlib>
+#include <istream>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <utility>
+
+// --server mode for toml-test-encoder and toml-test-decoder
+//
+// Rather than one process per document, documents are read from stdin
+// one after another, and each is answered on stdout:
+//
+//	request:	<length>\n<length bytes of document>
+//	response:	ok <length>\n<length bytes of output>
+//			or fail <length>\n<length bytes of error text>
+//
+// "ok" and "fail" stand in for the exit code a process would return.
+// The server stops at the end of input, or at a request it can't read.
+
+// reads the next request's document into buffer, reusing its storage
+inline bool read_frame(std::istream& in, std::string& buffer)
+{
+	auto length = std::size_t{};
+	if (!(in >> length) || in.get() != '\n')
+		return false;
+
+	buffer.resize(length);
+	return static_cast<bool>(in.read(data(buffer), static_cast<std::streamsize>(length)));
+}
+
+// name, if there is one, goes after the length; toml-test-decoder
+// names each file it decodes when given several
+inline void write_frame(std::ostream& out, const bool ok, const std::string_view body,
+	const std::string_view name = {})
+{
+	out << (ok ? "ok " : "fail ") << size(body);
+	if (!empty(name))
+		out << ' ' << name;
+	out << '\n';
+	out.write(data(body), static_cast<std::streamsize>(size(body)));
+	// the client waits for each response before sending the next request
+	out.flush();
+}
+
+// calls convert(document, out) for every request; convert returns false
+// for a failed document, with the reason written to out
+template<typename Convert>
+int serve(std::istream& in, std::ostream& out, Convert&& convert)
+{
+	auto document = std::string{};
+	auto response = std::ostringstream{};
+	while (read_frame(in, document))
+	{
+		response.str({});
+		const auto ok = convert(std::as_const(document), static_cast<std::ostream&>(response));
+		write_frame(out, ok, response.str());
+	}
+
+	return in.eof() ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+#endif
@@ -0,0 +1,203 @@
+#ifndef TOML_TEST_STATS_HPP
+#define TOML_TEST_STATS_HPP
+
+#include <algorithm>
+#include <chrono>
+#include <ctime>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "json.hpp"
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#include <psapi.h>	// link with psapi
+#elif defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#include <time.h>
+#endif
+
+// --stats mode for toml-test-encoder and toml-test-decoder
+//
+// The document goes through read, parse, convert and output as stages,
+// each timed on its own; convert makes the whole output in memory, and
+// output writes it to stdout. With --repeat n all of it is done n times,
+// bar reading stdin, which can only be done once. Once the run ends, a
+// json object goes to stderr on a line of its own, with each stage's
+// wall and cpu times, the bytes in and out, the document's node count
+// and the peak rss; here over several lines:
+//
+//	{
+//	  "tool" : "toml-test-decoder", "input" : "a.toml", "ok" : true,
+//	  "repeat" : 5, "bytes_in" : 1234, "bytes_out" : 5678, "nodes" : 90,
+//	  "peak_rss_bytes" : 4194304,
+//	  "stages" : {
+//	    "read" : { "runs" : 5, "wall_ns" : { "min" : ..., "median" : ...,
+//	      "max" : ..., "total" : ... }, "cpu_ns" : { ... } },
+//	    "parse" : { ... }, "convert" : { ... }, "output" : { ... }
+//	  }
+//	}
+//
+// Stages that didn't run, such as those after a failure, are left out.
+// Times are in whole nanoseconds.
+
+// the times of every run of one stage
+struct stage_times
+{
+	std::string_view name;
+	std::vector<double> wall_ns, cpu_ns;
+};
+
+// the cpu time the process has used, in nanoseconds; std::clock is
+// only a fallback, as on Windows it gives wall time
+inline double process_cpu_ns()
+{
+#if defined(_WIN32)
+	auto creation = FILETIME{}, exit = FILETIME{}, kernel = FILETIME{}, user = FILETIME{};
+	if (!GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user))
+		return 0;
+	const auto ticks = [](const FILETIME& t) {
+		return static_cast<unsigned long long>(t.dwHighDateTime) << 32 | t.dwLowDateTime;
+	};
+	return static_cast<double>(ticks(kernel) + ticks(user)) * 100;	// in 100 ns ticks
+#elif defined(CLOCK_PROCESS_CPUTIME_ID)
+	auto t = timespec{};
+	if (clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &t) != 0)
+		return 0;
+	return static_cast<double>(t.tv_sec) * 1e9 + static_cast<double>(t.tv_nsec);
+#else
+	return static_cast<double>(std::clock()) * 1e9 / CLOCKS_PER_SEC;
+#endif
+}
+
+// calls f(), adding its wall and cpu time to times, and returns what f
+// does; cpu time is the whole process's, see process_cpu_ns
+template<typename F>
+decltype(auto) timed(stage_times& times, F&& f)
+{
+	struct record
+	{
+		stage_times& times;
+		std::chrono::steady_clock::time_point wall = std::chrono::steady_clock::now();
+		double cpu = process_cpu_ns();
+
+		// on the way out, so a stage that throws is timed too
+		~record()
+		{
+			const auto cpu_ns = process_cpu_ns() - cpu;
+			times.wall_ns.push_back(std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - wall).count());
+			times.cpu_ns.push_back(cpu_ns);
+		}
+	};
+
+	const auto r = record{ times };
+	return std::forward<F>(f)();
+}
+
+// the most memory the process has had resident, or 0 where that isn't known
+inline long long peak_rss_bytes()
+{
+#if defined(_WIN32)
+	auto counters = PROCESS_MEMORY_COUNTERS{};
+	if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+		return 0;
+	return static_cast<long long>(counters.PeakWorkingSetSize);
+#elif defined(__unix__) || defined(__APPLE__)
+	auto usage = rusage{};
+	if (getrusage(RUSAGE_SELF, &usage) != 0)
+		return 0;
+#if defined(__APPLE__)
+	return usage.ru_maxrss;
+#else
+	return usage.ru_maxrss * 1024ll;	// in KiB on Linux and the BSDs
+#endif
+#else
+	return 0;
+#endif
+}
+
+struct run_stats
+{
+	std::string_view tool, input;	// input is empty for stdin
+	bool ok = false;
+	unsigned repeat = 1;
+	std::size_t bytes_in = 0, bytes_out = 0, nodes = 0;
+	std::vector<stage_times> stages;
+};
+
+inline void write_stats(std::ostream& strm, const run_stats& s)
+{
+	// json::Writer::Int takes a long, which is 32 bits on Windows
+	const auto integer = [](json::Writer& out, const long long i) {
+		out.Number(std::to_string(i));
+	};
+
+	const auto summary = [&](json::Writer& out, std::vector<double> ns) {
+		std::sort(begin(ns), end(ns));
+		auto total = 0.0;
+		for (const auto t : ns)
+			total += t;
+
+		out.BeginObject();
+		out.Key("min");
+		integer(out, static_cast<long long>(ns.front()));
+		out.Key("median");
+		integer(out, static_cast<long long>(ns[size(ns) / 2]));
+		out.Key("max");
+		integer(out, static_cast<long long>(ns.back()));
+		out.Key("total");
+		integer(out, static_cast<long long>(total));
+		out.EndObject();
+	};
+
+	auto out = json::Writer{ strm, json::Writer::Style::Compact };
+	out.BeginObject();
+	out.Key("tool");
+	out.String(s.tool);
+	out.Key("input");
+	out.String(empty(s.input) ? "-" : s.input);
+	out.Key("ok");
+	out.Bool(s.ok);
+	out.Key("repeat");
+	integer(out, s.repeat);
+	out.Key("bytes_in");
+	integer(out, static_cast<long long>(s.bytes_in));
+	out.Key("bytes_out");
+	integer(out, static_cast<long long>(s.bytes_out));
+	out.Key("nodes");
+	integer(out, static_cast<long long>(s.nodes));
+	out.Key("peak_rss_bytes");
+	integer(out, static_cast<long long>(peak_rss_bytes()));
+
+	out.Key("stages");
+	out.BeginObject();
+	for (const auto& stage : s.stages)
+	{
+		if (empty(stage.wall_ns))
+			continue;
+		out.Key(stage.name);
+		out.BeginObject();
+		out.Key("runs");
+		integer(out, static_cast<long long>(size(stage.wall_ns)));
+		out.Key("wall_ns");
+		summary(out, stage.wall_ns);
+		out.Key("cpu_ns");
+		summary(out, stage.cpu_ns);
+		out.EndObject();
+	}
+	out.EndObject();
+	out.EndObject();
+	out.Flush();
+	strm << '\n';
+}
+
+#endif
@@ -0,0 +1,175 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <sstream>
+#include <string>
+#include <string_view>
+
+#include "toml_to_json.hpp"
+
+using namespace std::string_literals;
+using namespace std::string_view_literals;
+
+// Stress tests for the decoder's nesting limit: documents nested as deep
+// as the default limit must convert with the limit raised to fit, and
+// fail with nesting_too_deep one level short of it. Deeper documents, up
+// to a million levels, must be turned away by check_nesting before the
+// toml parser, which recurses, ever sees them; and brackets in strings
+// and comments mustn't count.
+
+static auto failures = 0;
+
+static void expect(const bool ok, const char* what, const std::size_t depth)
+{
+	if (!ok)
+	{
+		std::printf("FAIL depth %zu: %s\n", depth, what);
+		++failures;
+	}
+}
+
+// a = [[[ ... 1 ... ]]]
+static std::string nested_arrays(const std::size_t depth)
+{
+	return "a = " + std::string(depth, '[') + "1" + std::string(depth, ']') + "\n";
+}
+
+// a = {b = {b = ... 1 ... }}
+static std::string nested_tables(const std::size_t depth)
+{
+	auto s = std::string{ "a = " };
+	for (auto i = std::size_t{}; i < depth; ++i)
+		s += "{b = ";
+	return s + "1" + std::string(depth, '}') + "\n";
+}
+
+static std::size_t count(const std::string& s, const char c)
+{
+	return static_cast<std::size_t>(std::count(begin(s), end(s), c));
+}
+
+// toml nests depth levels under the root table; the json gets the same
+// objects and arrays, plus one for the value at the bottom
+static void test_depth(const std::string& toml_text, const std::size_t depth, const char open)
+{
+	const auto start = std::chrono::steady_clock::now();
+
+	auto options = decode_options{};
+	options.max_depth = depth + 1;
+	auto out = std::ostringstream{};
+	expect(decode(toml_text, out, options), "decode at the limit", depth);
+
+	const auto json = out.str();
+	const auto objects = open == '{' ? depth + 2 : 2;
+	expect(count(json, '{') == objects && count(json, '}') == objects, "objects in output", depth);
+	if (open == '[')
+		expect(count(json, '[') == depth && count(json, ']') == depth, "arrays in output", depth);
+	expect(json.find("\"value\" : \"1\""sv) != std::string::npos, "value in output", depth);
+
+	options.check = true;
+	out.str({});
+	expect(decode(toml_text, out, options), "tree and direct output agree", depth);
+
+	options.check = false;
+	options.max_depth = depth;
+	out.str({});
+	expect(!decode(toml_text, out, options), "decode past the limit fails", depth);
+	expect(out.str().find("limit of " + std::to_string(depth)) != std::string::npos, "limit in error", depth);
+
+	const auto ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	std::printf("%-8s %8zu deep  %9.1f ms\n", open == '[' ? "arrays" : "tables", depth, ms);
+}
+
+// fails fast: the text is only scanned, never parsed
+static void test_rejected(const std::string& toml_text, const std::size_t depth, const char open)
+{
+	const auto start = std::chrono::steady_clock::now();
+
+	auto out = std::ostringstream{};
+	expect(!decode(toml_text, out) && out.str().find("limit of " + std::to_string(default_max_depth)) != std::string::npos,
+		"default limit stops deep nesting", depth);
+
+	auto thrown = false;
+	try
+	{
+		check_nesting(toml_text, depth);
+	}
+	catch (const nesting_too_deep&)
+	{
+		thrown = true;
+	}
+	expect(thrown, "check_nesting one level short", depth);
+
+	const auto ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	std::printf("%-8s %8zu deep  %9.1f ms, rejected\n", open == '[' ? "arrays" : "tables", depth, ms);
+}
+
+// brackets that aren't nesting, in every kind of string and in a comment
+static void test_not_nesting()
+{
+	const auto deep = std::string(1'000'000, '[') + std::string(1'000'000, '{');
+	const std::string documents[] = {
+		"a = \"" + deep + "\"\n",
+		"a = \"\\\"" + deep + "\\\"\"\n",
+		"a = '" + deep + "'\n",
+		"a = \"\"\"\n" + deep + "\n\"\"\"\"\"\n",
+		"a = '''" + deep + "'''''\n",
+		"# " + deep + "\na = 1\n",
+		"\"" + deep + "\" = 1\n",
+	};
+
+	for (const auto& toml_text : documents)
+	{
+		try
+		{
+			check_nesting(toml_text, 2);
+		}
+		catch (const nesting_too_deep&)
+		{
+			expect(false, "brackets in strings and comments don't nest", 1'000'000);
+		}
+	}
+
+	// and they don't hide those that do
+	for (const auto& toml_text : { "a = \"]]\"\nb = [[1]]\n"s, "a = 1 # ]]\nb = [[1]]\n"s, "a = '''\n]]'''\nb = {c = [1]}\n"s })
+	{
+		auto thrown = false;
+		try
+		{
+			check_nesting(toml_text, 2);
+		}
+		catch (const nesting_too_deep&)
+		{
+			thrown = true;
+		}
+		expect(thrown, "nesting after a string or comment", 3);
+	}
+}
+
+int main()
+{
+	// each table's members are indented by its depth, so the output grows
+	// with the square of it
+	for (const auto depth : { std::size_t{ 1 }, std::size_t{ 10 }, std::size_t{ 100 }, default_max_depth - 1 })
+	{
+		test_depth(nested_arrays(depth), depth, '[');
+		test_depth(nested_tables(depth), depth, '{');
+	}
+
+	for (const auto depth : { 10'000u, 100'000u, 1'000'000u })
+	{
+		test_rejected(nested_arrays(depth), depth, '[');
+		test_rejected(nested_tables(depth), depth, '{');
+	}
+
+	test_not_nesting();
+
+	if (failures != 0)
+	{
+		std::printf("%d failed\n", failures);
+		return EXIT_FAILURE;
+	}
+	std::printf("all passed\n");
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,130 @@
+#include <cstdio>
+#include <cstdlib>
+#include <initializer_list>
+#include <sstream>
+#include <string>
+#include <string_view>
+
+#include "toml_to_json.hpp"
+
+using namespace std::string_view_literals;
+
+// The decoder's two ways of writing json, stream_to_json through a
+// json::JSON tree and write_json straight from the toml, must give the
+// same bytes; checked over documents with every scalar type, strings
+// that need escaping, nested inline tables and arrays of tables.
+
+static auto failures = 0;
+
+static void expect(const bool ok, const char* what, const char* name)
+{
+	if (!ok)
+	{
+		std::printf("FAIL %s: %s\n", name, what);
+		++failures;
+	}
+}
+
+struct document
+{
+	const char* name;
+	std::string_view toml_text;
+	// each must be somewhere in the output
+	std::initializer_list<std::string_view> expected;
+};
+
+static const document documents[] = {
+	{ "scalars",
+		"string = \"plain\"\n"
+		"integer = 42\n"
+		"negative = -17\n"
+		"float = 3.5\n"
+		"exponent = 6.02e23\n"
+		"infinity = inf\n"
+		"not_a_number = nan\n"
+		"boolean = true\n"
+		"offset_datetime = 1979-05-27T07:32:00Z\n"
+		"local_datetime = 1979-05-27T07:32:00\n"
+		"local_date = 1979-05-27\n"
+		"local_time = 07:32:00\n"sv,
+		{ "\"string\""sv, "\"integer\""sv, "\"float\""sv, "\"bool\""sv, "\"datetime\""sv,
+			"\"datetime-local\""sv, "\"date-local\""sv, "\"time-local\""sv,
+			"\"inf\""sv, "\"nan\""sv } },
+
+	{ "escapes",
+		"quote = \"say \\\"hi\\\"\"\n"
+		"backslash = \"C:\\\\temp\"\n"
+		"controls = \"tab\\there\\nnew line\\u0001\\u007f\"\n"
+		"unicode = \"caf\\u00e9 \\U0001F600\"\n"
+		"\"key \\\"quoted\\\"\" = \"keys are escaped too\"\n"sv,
+		{ "\\\"hi\\\""sv, "C:\\\\temp"sv, "\\t"sv, "\\n"sv, "\\\"quoted\\\""sv } },
+
+	{ "inline tables",
+		"point = {x = 1, y = {z = 2, w = {v = \"deep\"}}}\n"
+		"mixed = [1, [2, 3], {a = {b = true}}]\n"
+		"empty_array = []\n"
+		"empty_table = {}\n"sv,
+		{ "\"deep\""sv, "\"empty_array\" : []"sv, "\"empty_table\" : {}"sv } },
+
+	{ "array tables",
+		"[[products]]\n"
+		"name = \"hammer\"\n"
+		"sku = 738594937\n"
+		"\n"
+		"[[products]]\n"
+		"\n"
+		"[[products]]\n"
+		"name = \"nail\"\n"
+		"color = \"grey\"\n"
+		"\n"
+		"[[fruits]]\n"
+		"name = \"apple\"\n"
+		"\n"
+		"[fruits.physical]\n"
+		"color = \"red\"\n"
+		"\n"
+		"[[fruits.varieties]]\n"
+		"name = \"red delicious\"\n"
+		"\n"
+		"[[fruits.varieties]]\n"
+		"name = \"granny smith\"\n"sv,
+		{ "\"products\""sv, "\"hammer\""sv, "\"nail\""sv, "\"varieties\""sv, "\"granny smith\""sv } },
+};
+
+int main()
+{
+	for (const auto& doc : documents)
+	{
+		try
+		{
+			const auto root = toml::parse(doc.toml_text);
+
+			auto dom = std::ostringstream{};
+			auto direct = std::ostringstream{};
+			stream_to_json(dom, root);
+			write_json(direct, root);
+
+			const auto json = direct.str();
+			expect(dom.str() == json, "tree and direct output differ", doc.name);
+			for (const auto& text : doc.expected)
+				expect(json.find(text) != std::string::npos, std::string{ text }.c_str(), doc.name);
+
+			auto options = decode_options{};
+			options.check = true;
+			auto out = std::ostringstream{};
+			expect(decode(doc.toml_text, out, options) && out.str() == json, "decode with check", doc.name);
+		}
+		catch (const std::exception& e)
+		{
+			expect(false, e.what(), doc.name);
+		}
+	}
+
+	if (failures != 0)
+	{
+		std::printf("%d failed\n", failures);
+		return EXIT_FAILURE;
+	}
+	std::printf("all passed\n");
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,97 @@
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <string_view>
+
+#include "toml_value.hpp"
+
+using namespace std::string_view_literals;
+
+// value_text formats date-times itself rather than asking as_string;
+// its text must be as_string's, byte for byte, for every form toml-test
+// writes them in: offsets and Z, either case of T and Z or a space
+// between date and time, and fractions of a second of any length.
+
+// the documents of toml-test's valid/datetime cases
+static constexpr std::string_view documents[] = {
+	// datetime.toml
+	"space = 1987-07-05 17:45:00Z\n"
+	"lower = 1987-07-05t17:45:00z\n"sv,
+
+	// local.toml
+	"local = 1987-07-05T17:45:00\n"
+	"milli = 1977-12-21T10:32:00.555\n"
+	"space = 1987-07-05 17:45:00\n"sv,
+
+	// local-date.toml
+	"bestdayever = 1987-07-05\n"sv,
+
+	// local-time.toml
+	"besttimeever = 17:45:00\n"
+	"milliseconds = 10:32:00.555\n"sv,
+
+	// milliseconds.toml
+	"utc1 = 1987-07-05T17:45:56.1234Z\n"
+	"utc2 = 1987-07-05T17:45:56.6Z\n"
+	"wita1 = 1987-07-05T17:45:56.1234+08:00\n"
+	"wita2 = 1987-07-05T17:45:56.6+08:00\n"sv,
+
+	// timekey.toml, offsets
+	"bestdayever = 1987-07-05T17:45:00Z\n"
+	"numoffset = 1977-06-28T07:32:00-05:00\n"
+	"milliseconds = 1977-12-21T10:32:00.555+00:00\n"
+	"minutes = 1979-05-27T00:32:00.999999-07:30\n"sv,
+
+	// edge.toml
+	"first-offset = 0001-01-01 00:00:00Z\n"
+	"first-local = 0001-01-01 00:00:00\n"
+	"first-date = 0001-01-01\n"
+	"last-offset = 9999-12-31 23:59:59Z\n"
+	"last-local = 9999-12-31 23:59:59\n"
+	"last-date = 9999-12-31\n"sv,
+
+	// leap-year.toml
+	"2000-datetime = 2000-02-29 15:15:15Z\n"
+	"2000-datetime-local = 2000-02-29 15:15:15\n"
+	"2000-date = 2000-02-29\n"
+	"2024-datetime = 2024-02-29 15:15:15Z\n"
+	"2024-datetime-local = 2024-02-29 15:15:15\n"
+	"2024-date = 2024-02-29\n"sv,
+};
+
+int main()
+{
+	auto failures = 0;
+	auto checked = 0;
+	auto buffer = std::string{};
+	for (const auto document : documents)
+	{
+		const auto root = toml::parse(document);
+		for (const auto& key : root)
+		{
+			const auto leaf = key.get_first_child();
+			const auto expected = leaf.as_string();
+			const auto text = value_text(leaf, buffer);
+			++checked;
+			if (text != expected)
+			{
+				std::printf("FAIL %s: \"%.*s\", as_string gives \"%s\"\n", key.as_string().c_str(),
+					static_cast<int>(size(text)), data(text), expected.c_str());
+				++failures;
+			}
+		}
+	}
+
+	if (checked == 0)
+	{
+		std::printf("FAIL: no date-times were checked\n");
+		return EXIT_FAILURE;
+	}
+	if (failures != 0)
+	{
+		std::printf("%d of %d failed\n", failures, checked);
+		return EXIT_FAILURE;
+	}
+	std::printf("all %d passed\n", checked);
+	return EXIT_SUCCESS;
+}
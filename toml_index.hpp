@@ -0,0 +1,233 @@
+#ifndef TOML_TEST_TOML_INDEX_HPP
+#define TOML_TEST_TOML_INDEX_HPP
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "another_toml/parser.hpp"
+
+namespace toml = another_toml;
+
+// Every table and value in a document, by its full key path, in a hash
+// table built once; for trees read many times and never changed, where
+// chained operator[] would compare keys at every level of every lookup.
+//
+// Paths are written as toml dotted keys: bare keys as they are, others
+// quoted, as append_key does, so r["a"]["b.c"] is found as a."b.c". A key
+// path reaches a table, an inline table, an array of tables or a value;
+// arrays and arrays of tables are indexed as a whole, not by element.
+//
+// The nodes found are copies of those in the tree, so the root_node the
+// index was built from must outlive it.
+class toml_index
+{
+public:
+	// a path and its hash, which can be worked out once, or at compile
+	// time, and used for every lookup
+	struct key
+	{
+		std::string_view path;
+		std::uint64_t hash;
+	};
+
+	// FNV-1a; paths are short, and this is simple enough to be constexpr
+	static constexpr std::uint64_t hash(const std::string_view path) noexcept
+	{
+		auto h = std::uint64_t{ 14695981039346656037u };
+		for (const auto c : path)
+		{
+			h ^= static_cast<unsigned char>(c);
+			h *= std::uint64_t{ 1099511628211u };
+		}
+		return h;
+	}
+
+	static constexpr key make_key(const std::string_view path) noexcept
+	{
+		return { path, hash(path) };
+	}
+
+	// appends k to path the way the index writes it, after a '.' unless
+	// path is empty; for building paths from keys that need quoting
+	static void append_key(std::string& path, const std::string_view k)
+	{
+		if (!empty(path))
+			path += '.';
+
+		const auto bare = [](const unsigned char c) {
+			return (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') ||
+				c == '_' || c == '-';
+		};
+
+		if (!empty(k) && std::all_of(begin(k), end(k), bare))
+		{
+			path += k;
+			return;
+		}
+
+		path += '"';
+		for (const auto c : k)
+		{
+			switch (c)
+			{
+			case '"': path += "\\\""; break;
+			case '\\': path += "\\\\"; break;
+			case '\b': path += "\\b"; break;
+			case '\t': path += "\\t"; break;
+			case '\n': path += "\\n"; break;
+			case '\f': path += "\\f"; break;
+			case '\r': path += "\\r"; break;
+			default:
+				if (static_cast<unsigned char>(c) < 0x20 || c == 0x7f)
+				{
+					constexpr auto hex = "0123456789ABCDEF";
+					path += "\\u00";
+					path += hex[(c >> 4) & 0xf];
+					path += hex[c & 0xf];
+				}
+				else
+					path += c;
+			}
+		}
+		path += '"';
+	}
+
+	toml_index() = default;
+
+	explicit toml_index(const toml::root_node& root)
+	{
+		// depth first, without recursion; each entry is the next child of
+		// a table still being indexed, and the length of that table's path
+		struct pending
+		{
+			std::optional<toml::node> next;
+			std::size_t prefix;
+		};
+
+		auto stack = std::vector<pending>{};
+		if (root.has_children())
+			stack.push_back({ root.get_first_child(), 0 });
+
+		auto path = std::string{};
+		while (!empty(stack))
+		{
+			auto& top = stack.back();
+			if (!top.next)
+			{
+				stack.pop_back();
+				continue;
+			}
+
+			const auto n = std::move(*top.next);
+			top.next.reset();
+			if (n.has_sibling())
+				top.next = n.get_next_sibling();
+
+			path.resize(top.prefix);
+			append_key(path, n.as_string());
+
+			if (n.table())
+			{
+				add(path, n);
+				if (n.has_children())
+					stack.push_back({ n.get_first_child(), path.size() });
+			}
+			else if (n.key())
+			{
+				const auto value = n.get_first_child();
+				add(path, value);
+				if (value.inline_table() && value.has_children())
+					stack.push_back({ value.get_first_child(), path.size() });
+			}
+			else
+			{
+				assert(n.array_table());
+				add(path, n);
+			}
+		}
+
+		build_table();
+	}
+
+	// the node at path, or nullptr if there isn't one
+	const toml::node* find(const std::string_view path) const noexcept
+	{
+		return find(make_key(path));
+	}
+
+	const toml::node* find(const key& k) const noexcept
+	{
+		if (empty(_slots))
+			return nullptr;
+
+		for (auto i = static_cast<std::size_t>(k.hash) & _mask;; i = (i + 1) & _mask)
+		{
+			const auto& s = _slots[i];
+			if (s.node == no_node)
+				return nullptr;
+			if (s.hash == k.hash && s.length == k.path.size() &&
+				std::memcmp(data(_paths) + s.offset, data(k.path), s.length) == 0)
+				return &_nodes[s.node];
+		}
+	}
+
+	bool contains(const std::string_view path) const noexcept { return find(path) != nullptr; }
+
+	std::size_t size() const noexcept { return _nodes.size(); }
+
+private:
+	static constexpr auto no_node = std::numeric_limits<std::uint32_t>::max();
+
+	// path is _paths[offset, offset + length), for _nodes[node]
+	struct slot
+	{
+		std::uint64_t hash = 0;
+		std::uint32_t offset = 0, length = 0;
+		std::uint32_t node = no_node;
+	};
+
+	void add(const std::string_view path, const toml::node& n)
+	{
+		assert(_paths.size() + path.size() < no_node && _nodes.size() < no_node);
+		_entries.push_back({ hash(path), static_cast<std::uint32_t>(_paths.size()),
+			static_cast<std::uint32_t>(path.size()), static_cast<std::uint32_t>(_nodes.size()) });
+		_paths += path;
+		_nodes.push_back(n);
+	}
+
+	// open addressing with linear probing, at most half full, so a miss
+	// ends at an empty slot after a probe or two
+	void build_table()
+	{
+		auto capacity = std::size_t{ 8 };
+		while (capacity < _entries.size() * 2)
+			capacity *= 2;
+
+		_slots.assign(capacity, slot{});
+		_mask = capacity - 1;
+		for (const auto& e : _entries)
+		{
+			auto i = static_cast<std::size_t>(e.hash) & _mask;
+			while (_slots[i].node != no_node)
+				i = (i + 1) & _mask;
+			_slots[i] = e;
+		}
+
+		_entries.clear();
+		_entries.shrink_to_fit();
+	}
+
+	std::string _paths;
+	std::vector<toml::node> _nodes;
+	std::vector<slot> _slots, _entries;
+	std::size_t _mask = 0;
+};
+
+#endif
@@ -0,0 +1,312 @@
+#include <algorithm>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "json.hpp"
+#include "toml_to_json.hpp"
+#include "toml_value.hpp"
+
+using namespace std::string_view_literals;
+
+nesting_too_deep::nesting_too_deep(const std::size_t max_depth)
+	: std::runtime_error{ "tables and arrays nest deeper than the limit of " + std::to_string(max_depth) }
+{}
+
+bool output_json(std::ostream& out, std::ostream& err, const toml::root_node& n,
+	const decode_options& options)
+{
+	if (options.check)
+	{
+		auto dom = std::ostringstream{};
+		auto direct = std::ostringstream{};
+		stream_to_json(dom, n, options.max_depth);
+		write_json(direct, n, options.max_depth);
+		const auto a = dom.str(), b = direct.str();
+		if (a != b)
+		{
+			const auto at = std::mismatch(begin(a), end(a), begin(b), end(b)).first - begin(a);
+			err << "direct output differs from the json tree at byte " << at << '\n';
+			return false;
+		}
+		out << b;
+	}
+	else if (options.use_dom)
+		stream_to_json(out, n, options.max_depth);
+	else
+		write_json(out, n, options.max_depth);
+	return true;
+}
+
+// the index of the quote that closes the string opening at text[i], or
+// of the last character looked at if it isn't closed
+static std::size_t string_end(const std::string_view text, std::size_t i)
+{
+	const auto quote = text[i];
+	const auto triple = quote == '"' ? "\"\"\""sv : "'''"sv;
+	const auto multiline = text.substr(i, 3) == triple;
+	for (i += multiline ? 3 : 1; i < size(text); ++i)
+	{
+		const auto c = text[i];
+		if (c == '\\' && quote == '"')
+			++i;
+		else if (c == '\n' && !multiline)
+			return i;
+		else if (c == quote && !multiline)
+			return i;
+		else if (c == quote && text.substr(i, 3) == triple)
+		{
+			// up to two more quotes can end a multi-line string's text
+			auto end = i + 2;
+			while (end + 1 < size(text) && end < i + 4 && text[end + 1] == quote)
+				++end;
+			return end;
+		}
+	}
+	return size(text) - 1;
+}
+
+void check_nesting(const std::string_view toml_text, const std::size_t max_depth)
+{
+	auto depth = std::size_t{ 1 };
+	if (depth > max_depth)
+		throw nesting_too_deep{ max_depth };
+
+	for (auto i = std::size_t{}; i < size(toml_text); ++i)
+	{
+		switch (toml_text[i])
+		{
+		case '[':
+		case '{':
+			if (++depth > max_depth)
+				throw nesting_too_deep{ max_depth };
+			break;
+		case ']':
+		case '}':
+			if (depth > 1)
+				--depth;
+			break;
+		case '"':
+		case '\'':
+			i = string_end(toml_text, i);
+			break;
+		case '#':
+			i = toml_text.find('\n', i);
+			if (i == std::string_view::npos)
+				return;
+			break;
+		}
+	}
+}
+
+bool decode(const std::string_view toml_text, std::ostream& out, const decode_options& options)
+{
+	auto toml_node = std::optional<toml::root_node>{};
+	try
+	{
+		check_nesting(toml_text, options.max_depth);
+		toml_node = toml::parse(toml_text);
+	}
+	catch (const std::exception& e)
+	{
+		out << e.what();
+		return false;
+	}
+
+	// as in toml-test-decoder, json errors still count as success; nesting
+	// past the limit doesn't, as there is no json for it. Nesting by
+	// dotted keys and table headers isn't seen by check_nesting, so the
+	// walk checks it again.
+	try
+	{
+		return output_json(out, out, *toml_node, options);
+	}
+	catch (const nesting_too_deep& e)
+	{
+		out << e.what();
+		return false;
+	}
+	catch (const std::exception&)
+	{
+		return true;
+	}
+}
+
+// Walks n depth first, calling out's begin_object, end_object,
+// begin_array, end_array, key and value(const toml::node&) as
+// json::Writer would be called to write it. Rather than recursing, a
+// work stack holds the next child of each table or array still open, so
+// nesting uses heap memory, a node and a flag per level, and past
+// max_depth levels nesting_too_deep is thrown before anything is opened.
+template<typename Out>
+void walk_toml(Out& out, const toml::root_node& n, const std::size_t max_depth)
+{
+	enum class level
+	{
+		table,			// children are keys, tables and array tables
+		array,			// children are values
+		array_table		// children are tables
+	};
+
+	struct frame
+	{
+		level kind;
+		std::optional<toml::node> next;
+	};
+
+	auto stack = std::vector<frame>{};
+	const auto open = [&](const auto& node, const level kind) {
+		if (size(stack) >= max_depth)
+			throw nesting_too_deep{ max_depth };
+		if (kind == level::table)
+			out.begin_object();
+		else
+			out.begin_array();
+		stack.push_back({ kind, node.has_children() ? std::optional{ node.get_first_child() } : std::nullopt });
+	};
+
+	const auto value = [&](const toml::node& node) {
+		if (node.array())
+			open(node, level::array);
+		else if (node.inline_table())
+			open(node, level::table);
+		else
+			out.value(node);
+	};
+
+	open(n, level::table);
+	while (!empty(stack))
+	{
+		auto& top = stack.back();
+		if (!top.next)
+		{
+			if (top.kind == level::table)
+				out.end_object();
+			else
+				out.end_array();
+			stack.pop_back();
+			continue;
+		}
+
+		// move top on to the next child first; opening this one may
+		// reallocate the stack
+		const auto node = std::move(*top.next);
+		assert(node.good());
+		top.next.reset();
+		if (node.has_sibling())
+			top.next = node.get_next_sibling();
+
+		switch (top.kind)
+		{
+		case level::table:
+			out.key(node.as_string());
+			if (node.table())
+				open(node, level::table);
+			else if (node.key())
+				value(node.get_first_child());
+			else
+			{
+				assert(node.array_table());
+				open(node, level::array_table);
+			}
+			break;
+		case level::array:
+			value(node);
+			break;
+		case level::array_table:
+			open(node, level::table);
+			break;
+		}
+	}
+}
+
+// walk_toml into a json::JSON tree; the stack holds the object or array
+// each open level is filling, and key the name the next value goes under
+class json_builder
+{
+public:
+	explicit json_builder(json::JSON& root) : _root{ root } {}
+
+	void key(std::string name) { _key = std::move(name); }
+
+	void begin_object() { _stack.push_back(&(place() = json::Object())); }
+	void begin_array() { _stack.push_back(&(place() = json::Array())); }
+	void end_object() { _stack.pop_back(); }
+	void end_array() { _stack.pop_back(); }
+
+	void value(const toml::node& n)
+	{
+		// one Tagged node rather than an object with two members; plain
+		// text, json::Writer escapes it on the way out
+		thread_local auto buffer = std::string{};
+		place() = json::JSON::Tagged(value_to_string(n.type()), value_text(n, buffer));
+	}
+
+private:
+	// the new value's slot, in the innermost object or array; earlier
+	// slots don't move, as their containers are done with until it closes
+	json::JSON& place()
+	{
+		if (empty(_stack))
+			return _root;
+
+		auto& parent = *_stack.back();
+		if (parent.JSONType() == json::JSON::Class::Object)
+			return parent[_key];
+
+		parent.append(json::JSON{});
+		return parent.at(static_cast<unsigned>(parent.length() - 1));
+	}
+
+	json::JSON& _root;
+	std::vector<json::JSON*> _stack;
+	std::string _key;
+};
+
+void stream_to_json(std::ostream& strm, const toml::root_node& n, const std::size_t max_depth)
+{
+	// build the whole tree in one arena, rather than a heap allocation per node
+	auto doc = json::Document{};
+	const auto scope = doc.Use();
+	auto builder = json_builder{ doc.Root() };
+	walk_toml(builder, n, max_depth);
+	strm << doc.Root();
+	return;
+}
+
+// The same output as stream_to_json, written while walking the toml;
+// nothing is kept but the writer's staging buffer, so array tables and
+// long arrays go out as they are visited.
+class json_writer
+{
+public:
+	explicit json_writer(std::ostream& strm) : _out{ strm } {}
+
+	void key(const std::string& name) { _out.Key(name); }
+
+	void begin_object() { _out.BeginObject(); }
+	void begin_array() { _out.BeginArray(); }
+	void end_object() { _out.EndObject(); }
+	void end_array() { _out.EndArray(); }
+
+	void value(const toml::node& n)
+	{
+		thread_local auto buffer = std::string{};
+		_out.BeginObject();
+		_out.Key("type"sv);
+		_out.RawString(value_to_string(n.type()));
+		_out.Key("value"sv);
+		_out.String(value_text(n, buffer));
+		_out.EndObject();
+	}
+
+private:
+	json::Writer _out;
+};
+
+void write_json(std::ostream& strm, const toml::root_node& n, const std::size_t max_depth)
+{
+	auto out = json_writer{ strm };
+	walk_toml(out, n, max_depth);
+}
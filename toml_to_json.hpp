@@ -0,0 +1,60 @@
+#ifndef TOML_TEST_TOML_TO_JSON_HPP
+#define TOML_TEST_TOML_TO_JSON_HPP
+
+#include <cstddef>
+#include <ostream>
+#include <stdexcept>
+#include <string_view>
+
+#include "another_toml/parser.hpp"
+
+// toml, converted to toml-test's json; what toml-test-decoder does, for
+// it and for toml-test-runner
+
+namespace toml = another_toml;
+
+// tables and arrays open at once, counting the root table; each is a
+// json object or array, and an entry on the conversion's work stack.
+// The toml parser recurses into arrays and inline tables, so this also
+// bounds the stack it needs, see check_nesting.
+constexpr std::size_t default_max_depth = 1'000;
+
+struct decode_options
+{
+	bool use_dom = false;	// build a json::JSON tree, then write that
+	bool check = false;		// write it both ways and fail if the two differ
+	std::size_t max_depth = default_max_depth;
+};
+
+// the toml nests deeper than max_depth; the conversion stops where it is
+class nesting_too_deep : public std::runtime_error
+{
+public:
+	explicit nesting_too_deep(std::size_t max_depth);
+};
+
+// Throws nesting_too_deep if the brackets and braces in toml_text, bar
+// those in strings and comments, nest deeper than max_depth, counting the
+// root table. This only reads the text, so it can be done before parsing;
+// the json nests at least as deep, so it rejects nothing the conversion
+// would take.
+void check_nesting(std::string_view toml_text, std::size_t max_depth = default_max_depth);
+
+// builds the json as a json::JSON tree, then writes it; writing and
+// freeing the tree recurse, so max_depth bounds the stack they use
+void stream_to_json(std::ostream&, const toml::root_node&, std::size_t max_depth = default_max_depth);
+
+// writes the same json while walking the toml, with no tree
+void write_json(std::ostream&, const toml::root_node&, std::size_t max_depth = default_max_depth);
+
+// writes n as json, the way the options ask; false if check found
+// the two ways to differ
+bool output_json(std::ostream& out, std::ostream& err, const toml::root_node& n,
+	const decode_options& options);
+
+// decodes one document into out; false if it isn't valid toml, nests
+// too deep, or check failed, with the reason written to out. Nesting is
+// checked before the toml is parsed.
+bool decode(std::string_view toml_text, std::ostream& out, const decode_options& options = {});
+
+#endif
@@ -0,0 +1,138 @@
+#ifndef TOML_TEST_TOML_VALUE_HPP
+#define TOML_TEST_TOML_VALUE_HPP
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <charconv>
+#include <cmath>
+#include <string>
+#include <string_view>
+
+#include "another_toml/parser.hpp"
+
+namespace toml = another_toml;
+
+// the "type" names toml-test uses, by toml::value_type; none needs json
+// escaping, so they can be written as they are
+constexpr auto value_strings = std::array<std::string_view, 11>{
+	"string", "integer", "float", "bool",
+	"datetime", "datetime-local", "date-local",
+	"time-local", "unknown", "bad", "out-of-range"
+};
+
+constexpr std::string_view value_to_string(const toml::value_type v)
+{
+	assert(static_cast<std::size_t>(v) < size(value_strings));
+	return value_strings[static_cast<std::size_t>(v)];
+}
+
+// writes v with at least width digits, zero padded, and returns the end
+inline char* write_padded(char* out, const unsigned v, const std::size_t width)
+{
+	auto digits = std::array<char, 10>{};
+	const auto res = std::to_chars(data(digits), data(digits) + size(digits), v);
+	const auto count = static_cast<std::size_t>(res.ptr - data(digits));
+	out = std::fill_n(out, width > count ? width - count : 0, '0');
+	return std::copy(data(digits), res.ptr, out);
+}
+
+// yyyy-mm-dd
+inline char* write_date(char* out, const toml::date& d)
+{
+	out = write_padded(out, d.year, 4);
+	*out++ = '-';
+	out = write_padded(out, d.month, 2);
+	*out++ = '-';
+	return write_padded(out, d.day, 2);
+}
+
+// hh:mm:ss, then the fraction of a second, in microseconds, without
+// its trailing zeros
+inline char* write_time(char* out, const toml::time& t)
+{
+	out = write_padded(out, t.hours, 2);
+	*out++ = ':';
+	out = write_padded(out, t.minutes, 2);
+	*out++ = ':';
+	out = write_padded(out, t.seconds, 2);
+	if (t.seconds_frac != 0)
+	{
+		*out++ = '.';
+		auto frac = static_cast<unsigned>(t.seconds_frac);
+		auto width = std::size_t{ 6 };
+		for (; frac % 10 == 0; frac /= 10)
+			--width;
+		out = write_padded(out, frac, width);
+	}
+	return out;
+}
+
+// The "value" text toml-test expects for a scalar, in the form as_string
+// gives it. Integers, floats and date-times are formatted with to_chars
+// into buffer, which keeps its capacity from one call to the next, and
+// booleans are constants; none of them allocate once buffer has grown.
+// Strings come from as_string, which makes a new string each time.
+inline std::string_view value_text(const toml::node& n, std::string& buffer)
+{
+	// the longest is an offset date-time with a fraction:
+	// yyyy-mm-ddThh:mm:ss.ffffff+hh:mm
+	auto chars = std::array<char, 40>{};
+	auto res = std::to_chars_result{};
+	switch (n.type())
+	{
+	case toml::value_type::integer:
+		res = std::to_chars(data(chars), data(chars) + size(chars), n.as_integer());
+		break;
+	case toml::value_type::floating_point:
+	{
+		// shortest text that reads back as the same double; toml-test
+		// compares floats by value, and writes nan without a sign
+		const auto f = n.as_floating();
+		if (std::isnan(f))
+			return "nan";
+		res = std::to_chars(data(chars), data(chars) + size(chars), f);
+	}break;
+	case toml::value_type::boolean:
+		return n.as_boolean() ? "true" : "false";
+	case toml::value_type::date_time:
+	{
+		const auto dt = n.as_date_time();
+		auto out = write_date(data(chars), dt);
+		*out++ = 'T';
+		out = write_time(out, dt);
+		if (dt.offset_hours == 0 && dt.offset_minutes == 0)
+			*out++ = 'Z';
+		else
+		{
+			*out++ = dt.offset_positive ? '+' : '-';
+			out = write_padded(out, dt.offset_hours, 2);
+			*out++ = ':';
+			out = write_padded(out, dt.offset_minutes, 2);
+		}
+		res.ptr = out;
+	}break;
+	case toml::value_type::local_date_time:
+	{
+		const auto dt = n.as_date_time_local();
+		auto out = write_date(data(chars), dt);
+		*out++ = 'T';
+		res.ptr = write_time(out, dt);
+	}break;
+	case toml::value_type::local_date:
+		res.ptr = write_date(data(chars), n.as_date_local());
+		break;
+	case toml::value_type::local_time:
+		res.ptr = write_time(data(chars), n.as_time_local());
+		break;
+	default:
+		buffer = n.as_string();
+		return buffer;
+	}
+
+	assert(res.ec == std::errc{});
+	buffer.assign(data(chars), res.ptr);
+	return buffer;
+}
+
+#endif